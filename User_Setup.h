@@ -24,8 +24,10 @@
 #define SPI_FREQUENCY  40000000
 #define SPI_READ_FREQUENCY  20000000
 
-// Font loading
+// Font loading. The firmware only draws the GLCD font, the minimal profile
+// sets TFT_GLCD_ONLY to leave the rest out of flash.
 #define LOAD_GLCD
+#ifndef TFT_GLCD_ONLY
 #define LOAD_FONT2
 #define LOAD_FONT4
 #define LOAD_FONT6
@@ -33,3 +35,4 @@
 #define LOAD_FONT8
 #define LOAD_GFXFF
 #define SMOOTH_FONT
+#endif
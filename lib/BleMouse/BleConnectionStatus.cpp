@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <esp_bt.h>
+#include "BleConnectionStatus.h"
+#include "BleMouse.h"
+
+BleConnectionStatus::BleConnectionStatus(void) {
+}
+
+void BleConnectionStatus::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param)
+{
+  this->server = pServer;
+
+  int slot = -1;
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (!this->hosts[i].connected)
+    {
+      slot = i;
+      break;
+    }
+  }
+
+  // Advertising stops once all slots are taken, but a central can still
+  // race it
+  if (slot < 0)
+  {
+    pServer->disconnect(param->connect.conn_id);
+    return;
+  }
+
+  BleHost &host = this->hosts[slot];
+  host.connected = true;
+  host.connId = param->connect.conn_id;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+  host.connHandle = param->connect.conn_handle;
+#else
+  // Older Bluedroid does not pass the handle on. Its conn_id is the index
+  // of the GATT link, which only matches the handle's while both sides hand
+  // out free slots in the same order. Not guaranteed, hence the newer path.
+  host.connHandle = param->connect.conn_id;
+#endif
+  memcpy(host.address, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+  host.interval = param->connect.conn_params.interval;
+  host.latency = param->connect.conn_params.latency;
+  host.timeout = param->connect.conn_params.timeout;
+  host.updateRequestedAt = 0;
+  host.rssi = 0;
+  host.txPower = MOUSE_TX_DEFAULT_DBM;
+  // Host details first, loop() only looks at them once the mask says so
+  __atomic_or_fetch(&this->hostMask, (uint8_t)(1 << slot), __ATOMIC_RELEASE);
+
+  // A new host starts at whole notches until it sets the multiplier itself.
+  // The value is shared, a host that set it earlier gets slower scrolling.
+  if (this->featureMouse)
+  {
+    uint8_t multiplier = 0;
+    this->featureMouse->setValue(&multiplier, 1);
+  }
+
+  if (!this->connected)
+  {
+    __atomic_store_n(&this->connected, true, __ATOMIC_RELEASE);
+    BLE2902* desc = (BLE2902*)this->inputMouse->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+    desc->setNotifications(true);
+
+    if (this->disconnectedAt != 0)
+    {
+      this->reconnectLatency = millis() - this->disconnectedAt;
+      this->reconnects++;
+      this->disconnectedAt = 0;
+    }
+  }
+
+  // The controller stops advertising on connect, keep a free slot visible
+  if (this->hostMask != (1 << BLE_MAX_HOSTS) - 1)
+    pServer->startAdvertising();
+
+  if (this->callback)
+    this->callback();
+}
+
+void BleConnectionStatus::requestUpdate(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout)
+{
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    BleHost &host = this->hosts[i];
+    if (!host.connected)
+      continue;
+
+    esp_ble_conn_update_params_t params;
+    memcpy(params.bda, host.address, sizeof(esp_bd_addr_t));
+    params.min_int = minInterval;
+    params.max_int = maxInterval;
+    params.latency = latency;
+    params.timeout = timeout;
+
+    if (esp_ble_gap_update_conn_params(&params) == ESP_OK)
+      host.updateRequestedAt = millis() | 1;
+  }
+}
+
+void BleConnectionStatus::onUpdate(esp_ble_gap_cb_param_t *param)
+{
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    BleHost &host = this->hosts[i];
+    if (!host.connected || memcmp(host.address, param->update_conn_params.bda, sizeof(esp_bd_addr_t)) != 0)
+      continue;
+
+    // Also sent when the central changes parameters on its own
+    if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS)
+    {
+      host.interval = param->update_conn_params.conn_int;
+      host.latency = param->update_conn_params.latency;
+      host.timeout = param->update_conn_params.timeout;
+    }
+    else
+    {
+      this->updatesRejected++;
+    }
+
+    if (host.updateRequestedAt != 0)
+    {
+      host.updateTime = millis() - host.updateRequestedAt;
+      host.updateRequestedAt = 0;
+    }
+  }
+}
+
+void BleConnectionStatus::readRssi(void)
+{
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (this->hosts[i].connected)
+      esp_ble_gap_read_rssi(this->hosts[i].address);
+  }
+}
+
+void BleConnectionStatus::onRssi(esp_ble_gap_cb_param_t *param)
+{
+  if (param->read_rssi_cmpl.status != ESP_BT_STATUS_SUCCESS)
+    return;
+
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    BleHost &host = this->hosts[i];
+    if (host.connected && memcmp(host.address, param->read_rssi_cmpl.remote_addr, sizeof(esp_bd_addr_t)) == 0)
+      host.rssi = param->read_rssi_cmpl.rssi;
+  }
+}
+
+bool BleConnectionStatus::setTxPower(uint8_t slot, int8_t dbm)
+{
+  BleHost &host = this->hosts[slot];
+  if (!host.connected)
+    return false;
+
+  // Levels run up from ESP_PWR_LVL_N12 in 3 dB steps, one power type per
+  // connection handle
+  if (host.connHandle > ESP_BLE_PWR_TYPE_CONN_HDL8 - ESP_BLE_PWR_TYPE_CONN_HDL0)
+    return false;
+  int level = (constrain(dbm, MOUSE_TX_MIN_DBM, MOUSE_TX_MAX_DBM) - MOUSE_TX_MIN_DBM + MOUSE_TX_STEP_DB - 1) / MOUSE_TX_STEP_DB;
+  esp_ble_power_type_t type = (esp_ble_power_type_t)(ESP_BLE_PWR_TYPE_CONN_HDL0 + host.connHandle);
+  if (esp_ble_tx_power_set(type, (esp_power_level_t)(ESP_PWR_LVL_N12 + level)) != ESP_OK)
+    return false;
+
+  host.txPower = MOUSE_TX_MIN_DBM + level * MOUSE_TX_STEP_DB;
+  return true;
+}
+
+uint16_t BleConnectionStatus::slowestInterval(void)
+{
+  uint16_t interval = 0;
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (this->hosts[i].connected && this->hosts[i].interval > interval)
+      interval = this->hosts[i].interval;
+  }
+  return interval;
+}
+
+void BleConnectionStatus::disconnectAll(void)
+{
+  if (this->server == nullptr)
+    return;
+
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (this->hosts[i].connected)
+      this->server->disconnect(this->hosts[i].connId);
+  }
+}
+
+void BleConnectionStatus::onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param)
+{
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (this->hosts[i].connected && this->hosts[i].connId == param->disconnect.conn_id)
+    {
+      this->hosts[i].connected = false;
+      __atomic_and_fetch(&this->hostMask, (uint8_t)~(1 << i), __ATOMIC_RELEASE);
+    }
+  }
+
+  if (this->hostMask == 0 && this->connected)
+  {
+    __atomic_store_n(&this->connected, false, __ATOMIC_RELEASE);
+    BLE2902* desc = (BLE2902*)this->inputMouse->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+    desc->setNotifications(false);
+    this->disconnectedAt = millis() | 1;  // Never 0, which means connected
+  }
+
+  // Advertise again so the host can reconnect without a reboot
+  pServer->startAdvertising();
+
+  if (this->callback)
+    this->callback();
+}
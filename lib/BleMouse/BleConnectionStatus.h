@@ -0,0 +1,67 @@
+#ifndef ESP32_BLE_CONNECTION_STATUS_H
+#define ESP32_BLE_CONNECTION_STATUS_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include <BLEServer.h>
+#include <esp_gap_ble_api.h>
+#include <esp_idf_version.h>
+#include "BLE2902.h"
+#include "BLECharacteristic.h"
+
+// Centrals served at the same time, the controller allows up to
+// CONFIG_BTDM_CTRL_BLE_MAX_CONN (3 by default)
+#ifndef BLE_MAX_HOSTS
+#define BLE_MAX_HOSTS 3
+#endif
+
+// One connected central. Connection parameters as negotiated with it,
+// interval in units of 1.25 ms, latency in connection events, timeout in
+// units of 10 ms
+struct BleHost
+{
+  bool connected = false;
+  uint16_t connId = 0;
+  uint16_t connHandle = 0;  // HCI connection handle, the controller sets TX power by it
+  esp_bd_addr_t address;
+  uint16_t interval = 0;
+  uint16_t latency = 0;
+  uint16_t timeout = 0;
+  uint32_t updateRequestedAt = 0;  // millis() of a pending update request, 0 if none
+  uint32_t updateTime = 0;         // Request to update round trip of the last update
+  int8_t rssi = 0;                 // dBm of the last reading, 0 before the first
+  int8_t txPower = 0;              // dBm
+};
+
+class BleConnectionStatus : public BLEServerCallbacks
+{
+public:
+  BleConnectionStatus(void);
+  bool connected = false;  // At least one host
+  uint8_t hostMask = 0;    // Bit per connected slot in hosts
+  BleHost hosts[BLE_MAX_HOSTS];
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param);
+  void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param);
+  BLECharacteristic* inputMouse;
+  BLECharacteristic* featureMouse = nullptr;  // Reset for every new host
+  BLEServer* server = nullptr;
+  void (*callback)(void) = nullptr;  // Runs on the BLE task after every change
+
+  // Reconnect instrumentation, all times from millis(). A reconnect is the
+  // first host coming back after the last one left.
+  uint32_t disconnectedAt = 0;    // 0 while connected or before the first connection
+  uint32_t reconnectLatency = 0;  // Disconnect to connected time of the last reconnect
+  uint16_t reconnects = 0;
+
+  uint16_t updatesRejected = 0;
+  void requestUpdate(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+  void onUpdate(esp_ble_gap_cb_param_t *param);
+  void readRssi(void);
+  void onRssi(esp_ble_gap_cb_param_t *param);
+  bool setTxPower(uint8_t slot, int8_t dbm);
+  uint16_t slowestInterval(void);
+  void disconnectAll(void);
+};
+
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_BLE_CONNECTION_STATUS_H
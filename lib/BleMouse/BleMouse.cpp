@@ -0,0 +1,558 @@
+#include <Arduino.h>
+#include <new>
+#include <BLEDevice.h>
+#include <BLEUtils.h>
+#include <BLEServer.h>
+#include "BLE2902.h"
+#include "BLEHIDDevice.h"
+#include "HIDTypes.h"
+#include "HIDKeyboardTypes.h"
+#include <driver/adc.h>
+#include "sdkconfig.h"
+
+#include "BleConnectionStatus.h"
+#include "BleMouse.h"
+
+#if defined(CONFIG_ARDUHAL_ESP_LOG)
+  #include "esp32-hal-log.h"
+  #define LOG_TAG ""
+#else
+  #include "esp_log.h"
+  static const char* LOG_TAG = "BLEDevice";
+#endif
+
+// The GAP handler is a plain function pointer, there is only one mouse
+static BleConnectionStatus* gapConnectionStatus = nullptr;
+
+// The GATTS handler too. It hands the report task the outcome of each
+// notification it sent, one host at a time.
+static uint16_t inputHandle = 0;
+static SemaphoreHandle_t notifyDone = NULL;
+static StaticSemaphore_t notifyDoneBuffer;
+static volatile esp_gatt_status_t notifyStatus;
+
+// Objects the stack keeps pointers to, there is only one mouse. The HID
+// device needs the server to construct, it is built in place in start().
+static BLESecurity security;
+alignas(BLEHIDDevice) static uint8_t hidStorage[sizeof(BLEHIDDevice)];
+
+static const uint8_t _hidReportDescriptor[] = {
+  USAGE_PAGE(1),       0x01, // USAGE_PAGE (Generic Desktop)
+  USAGE(1),            0x02, // USAGE (Mouse)
+  COLLECTION(1),       0x01, // COLLECTION (Application)
+  USAGE(1),            0x01, //   USAGE (Pointer)
+  COLLECTION(1),       0x00, //   COLLECTION (Physical)
+  // ------------------------------------------------- Buttons (Left, Right, Middle, Back, Forward)
+  USAGE_PAGE(1),       0x09, //     USAGE_PAGE (Button)
+  USAGE_MINIMUM(1),    0x01, //     USAGE_MINIMUM (Button 1)
+  USAGE_MAXIMUM(1),    0x05, //     USAGE_MAXIMUM (Button 5)
+  LOGICAL_MINIMUM(1),  0x00, //     LOGICAL_MINIMUM (0)
+  LOGICAL_MAXIMUM(1),  0x01, //     LOGICAL_MAXIMUM (1)
+  REPORT_SIZE(1),      0x01, //     REPORT_SIZE (1)
+  REPORT_COUNT(1),     0x05, //     REPORT_COUNT (5)
+  HIDINPUT(1),         0x02, //     INPUT (Data, Variable, Absolute) ;5 button bits
+  // ------------------------------------------------- Padding
+  REPORT_SIZE(1),      0x03, //     REPORT_SIZE (3)
+  REPORT_COUNT(1),     0x01, //     REPORT_COUNT (1)
+  HIDINPUT(1),         0x03, //     INPUT (Constant, Variable, Absolute) ;3 bit padding
+  // ------------------------------------------------- X/Y position, Wheel
+  USAGE_PAGE(1),       0x01, //     USAGE_PAGE (Generic Desktop)
+  USAGE(1),            0x30, //     USAGE (X)
+  USAGE(1),            0x31, //     USAGE (Y)
+  USAGE(1),            0x38, //     USAGE (Wheel)
+  LOGICAL_MINIMUM(1),  0x81, //     LOGICAL_MINIMUM (-127)
+  LOGICAL_MAXIMUM(1),  0x7f, //     LOGICAL_MAXIMUM (127)
+  REPORT_SIZE(1),      0x08, //     REPORT_SIZE (8)
+  REPORT_COUNT(1),     0x03, //     REPORT_COUNT (3)
+  HIDINPUT(1),         0x06, //     INPUT (Data, Variable, Relative) ;3 bytes (X,Y,Wheel)
+  // ------------------------------------------------- Horizontal wheel
+  USAGE_PAGE(1),       0x0c, //     USAGE PAGE (Consumer Devices)
+  USAGE(2),      0x38, 0x02, //     USAGE (AC Pan)
+  LOGICAL_MINIMUM(1),  0x81, //     LOGICAL_MINIMUM (-127)
+  LOGICAL_MAXIMUM(1),  0x7f, //     LOGICAL_MAXIMUM (127)
+  REPORT_SIZE(1),      0x08, //     REPORT_SIZE (8)
+  REPORT_COUNT(1),     0x01, //     REPORT_COUNT (1)
+  HIDINPUT(1),         0x06, //     INPUT (Data, Var, Rel)
+  END_COLLECTION(0),         //   END_COLLECTION
+  END_COLLECTION(0)          // END_COLLECTION
+};
+
+// Report ID 1 carries the movement, report ID 2 is the feature report with
+// the Resolution Multiplier. The multiplier covers both wheels, they share
+// its logical collection.
+#define REPORT_ID_MOUSE 1
+#define REPORT_ID_RESOLUTION 2
+
+static const uint8_t _hidReportDescriptor16[] = {
+  USAGE_PAGE(1),       0x01, // USAGE_PAGE (Generic Desktop)
+  USAGE(1),            0x02, // USAGE (Mouse)
+  COLLECTION(1),       0x01, // COLLECTION (Application)
+  REPORT_ID(1),        REPORT_ID_MOUSE,
+  USAGE(1),            0x01, //   USAGE (Pointer)
+  COLLECTION(1),       0x00, //   COLLECTION (Physical)
+  // ------------------------------------------------- Buttons (Left, Right, Middle, Back, Forward)
+  USAGE_PAGE(1),       0x09, //     USAGE_PAGE (Button)
+  USAGE_MINIMUM(1),    0x01, //     USAGE_MINIMUM (Button 1)
+  USAGE_MAXIMUM(1),    0x05, //     USAGE_MAXIMUM (Button 5)
+  LOGICAL_MINIMUM(1),  0x00, //     LOGICAL_MINIMUM (0)
+  LOGICAL_MAXIMUM(1),  0x01, //     LOGICAL_MAXIMUM (1)
+  REPORT_SIZE(1),      0x01, //     REPORT_SIZE (1)
+  REPORT_COUNT(1),     0x05, //     REPORT_COUNT (5)
+  HIDINPUT(1),         0x02, //     INPUT (Data, Variable, Absolute) ;5 button bits
+  // ------------------------------------------------- Padding
+  REPORT_SIZE(1),      0x03, //     REPORT_SIZE (3)
+  REPORT_COUNT(1),     0x01, //     REPORT_COUNT (1)
+  HIDINPUT(1),         0x03, //     INPUT (Constant, Variable, Absolute) ;3 bit padding
+  // ------------------------------------------------- X/Y position
+  USAGE_PAGE(1),       0x01, //     USAGE_PAGE (Generic Desktop)
+  USAGE(1),            0x30, //     USAGE (X)
+  USAGE(1),            0x31, //     USAGE (Y)
+  LOGICAL_MINIMUM(2),  0x01, 0x80, // LOGICAL_MINIMUM (-32767)
+  LOGICAL_MAXIMUM(2),  0xff, 0x7f, // LOGICAL_MAXIMUM (32767)
+  REPORT_SIZE(1),      0x10, //     REPORT_SIZE (16)
+  REPORT_COUNT(1),     0x02, //     REPORT_COUNT (2)
+  HIDINPUT(1),         0x06, //     INPUT (Data, Variable, Relative) ;2 words (X,Y)
+  COLLECTION(1),       0x02, //     COLLECTION (Logical)
+  // ------------------------------------------------- Resolution Multiplier
+  REPORT_ID(1),        REPORT_ID_RESOLUTION,
+  USAGE(1),            0x48, //       USAGE (Resolution Multiplier)
+  LOGICAL_MINIMUM(1),  0x00, //       LOGICAL_MINIMUM (0)
+  LOGICAL_MAXIMUM(1),  0x01, //       LOGICAL_MAXIMUM (1)
+  PHYSICAL_MINIMUM(1), 0x01, //       PHYSICAL_MINIMUM (1)
+  PHYSICAL_MAXIMUM(1), MOUSE_WHEEL_MULTIPLIER, // PHYSICAL_MAXIMUM
+  REPORT_SIZE(1),      0x02, //       REPORT_SIZE (2)
+  REPORT_COUNT(1),     0x01, //       REPORT_COUNT (1)
+  FEATURE(1),          0x02, //       FEATURE (Data, Variable, Absolute)
+  PHYSICAL_MINIMUM(1), 0x00, //       PHYSICAL_MINIMUM (0)
+  PHYSICAL_MAXIMUM(1), 0x00, //       PHYSICAL_MAXIMUM (0)
+  REPORT_SIZE(1),      0x06, //       REPORT_SIZE (6)
+  FEATURE(1),          0x03, //       FEATURE (Constant) ;6 bit padding
+  // ------------------------------------------------- Wheel, horizontal wheel
+  REPORT_ID(1),        REPORT_ID_MOUSE,
+  USAGE(1),            0x38, //       USAGE (Wheel)
+  LOGICAL_MINIMUM(2),  0x01, 0x80, // LOGICAL_MINIMUM (-32767)
+  LOGICAL_MAXIMUM(2),  0xff, 0x7f, // LOGICAL_MAXIMUM (32767)
+  REPORT_SIZE(1),      0x10, //       REPORT_SIZE (16)
+  REPORT_COUNT(1),     0x01, //       REPORT_COUNT (1)
+  HIDINPUT(1),         0x06, //       INPUT (Data, Variable, Relative)
+  USAGE_PAGE(1),       0x0c, //       USAGE PAGE (Consumer Devices)
+  USAGE(2),      0x38, 0x02, //       USAGE (AC Pan)
+  HIDINPUT(1),         0x06, //       INPUT (Data, Variable, Relative)
+  END_COLLECTION(0),         //     END_COLLECTION
+  END_COLLECTION(0),         //   END_COLLECTION
+  END_COLLECTION(0)          // END_COLLECTION
+};
+
+BleMouse::BleMouse(const char* deviceName, const char* deviceManufacturer, uint8_t batteryLevel) : 
+    _buttons(0),
+    hid(0),
+    featureMouse(0),
+    format(MOUSE_FORMAT_8BIT),
+    reportTask(NULL),
+    reportsSent(0),
+    reportsCoalesced(0),
+    reportsDropped(0),
+    reportsFailed(0),
+    reportsRetried(0),
+    reportsLost(0)
+{
+  this->queueMux = portMUX_INITIALIZER_UNLOCKED;
+  this->deviceName = deviceName;
+  this->deviceManufacturer = deviceManufacturer;
+  this->batteryLevel = batteryLevel;
+#if defined(PROBES) && PROBES
+  this->sendProbe = nullptr;
+#endif
+  this->sentCallback = nullptr;
+}
+
+void BleMouse::setReportFormat(uint8_t format)
+{
+  this->format = format;
+}
+
+uint8_t BleMouse::reportFormat(void)
+{
+  return this->format;
+}
+
+int16_t BleMouse::axisLimit(void)
+{
+  return mouseAxisLimit(this->format);
+}
+
+uint8_t BleMouse::wheelResolution(void)
+{
+  // Written by the BLE task, one byte
+  if (this->featureMouse == 0 || this->featureMouse->getLength() == 0)
+    return 1;
+  return mouseWheelResolution(this->featureMouse->getData()[0]);
+}
+
+void BleMouse::begin(void)
+{
+  // Reports go out from the caller's core, keep the other one free for slower work
+  if (this->reportTask == NULL)
+    this->reportTask = xTaskCreateStaticPinnedToCore(this->taskReports, "reports", MOUSE_TASK_STACK, (void *)this, 5,
+                                                     this->reportStack, &this->reportTaskBuffer, xPortGetCoreID());
+
+  // Set up on the caller's stack rather than in a task of its own, nothing
+  // of it is needed once advertising runs
+  this->start();
+}
+
+uint32_t BleMouse::reportStackFree(void) {
+  return this->reportTask ? uxTaskGetStackHighWaterMark(this->reportTask) * sizeof(StackType_t) : 0;
+}
+
+void BleMouse::end(void)
+{
+}
+
+void BleMouse::click(uint8_t b)
+{
+  _buttons = b;
+  move(0,0,0,0);
+  _buttons = 0;
+  move(0,0,0,0);
+}
+
+void BleMouse::move(signed char x, signed char y, signed char wheel, signed char hWheel)
+{
+  if (this->isConnected())
+  {
+    MouseReport report = { _buttons, x, y, wheel, hWheel, 0 };
+    enqueue(&report, 1);
+  }
+}
+
+bool BleMouse::enqueue(const MouseReport *queued, uint8_t count)
+{
+  portENTER_CRITICAL(&this->queueMux);
+  bool fits = this->queue.push(queued, count);
+  portEXIT_CRITICAL(&this->queueMux);
+
+  if (!fits)
+  {
+    this->reportsDropped += count;
+    return false;
+  }
+
+  if (this->reportTask != NULL)
+    xTaskNotifyGive(this->reportTask);
+  return true;
+}
+
+uint8_t BleMouse::queued(void)
+{
+  portENTER_CRITICAL(&this->queueMux);
+  uint8_t used = this->queue.used();
+  portEXIT_CRITICAL(&this->queueMux);
+  return used;
+}
+
+void BleMouse::clearQueue(void)
+{
+  portENTER_CRITICAL(&this->queueMux);
+  this->queue.clear();
+  portEXIT_CRITICAL(&this->queueMux);
+}
+
+bool BleMouse::pop(MouseReport &report)
+{
+  portENTER_CRITICAL(&this->queueMux);
+  bool found = this->queue.pop(report);
+  portEXIT_CRITICAL(&this->queueMux);
+  return found;
+}
+
+bool BleMouse::mergeNext(MouseReport &report)
+{
+  int limit = this->axisLimit();
+  portENTER_CRITICAL(&this->queueMux);
+  bool merged = this->queue.mergeNext(report, limit);
+  portEXIT_CRITICAL(&this->queueMux);
+  return merged;
+}
+
+uint32_t BleMouse::alignToConnection(uint32_t delay)
+{
+  // With several hosts the slowest one sets the pace
+  return mouseAlignToConnection(delay, this->connectionStatus.slowestInterval());
+}
+
+void BleMouse::send(const MouseReport &report)
+{
+  if (!this->isConnected())
+  {
+    this->reportsDropped++;
+    return;
+  }
+
+  uint8_t m[MOUSE_REPORT_MAX];
+  uint8_t length = mouseEncode(report, this->format, m);
+#if defined(PROBES) && PROBES
+  uint32_t started = micros();
+#endif
+  // One notification per host rather than notify() to all, so a host that
+  // missed it can get it again without the others seeing it twice
+  this->inputMouse->setValue(m, length);
+  uint8_t missed = this->notifyHosts(this->hosts(), m, length);
+  this->reportsSent++;
+#if defined(PROBES) && PROBES
+  if (this->sendProbe)
+    this->sendProbe(micros() - started);
+#endif
+  if (this->sentCallback)
+    this->sentCallback(report);
+
+  // Again one connection event later, until every host has it or has left.
+  // Later reports wait, so none of them overtakes this one, but only for
+  // MOUSE_RETRY_MAX events: a host that keeps failing must not hold up the
+  // queue, clearQueue() and the other hosts.
+  for (int tries = 0; missed != 0; tries++)
+  {
+    if (tries == MOUSE_RETRY_MAX)
+    {
+      this->reportsLost += __builtin_popcount(missed);
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(this->alignToConnection(1)));
+    missed &= this->hosts();
+    this->reportsRetried += __builtin_popcount(missed);
+    missed = this->notifyHosts(missed, m, length);
+  }
+}
+
+uint8_t BleMouse::notifyHosts(uint8_t slots, uint8_t *m, uint8_t length)
+{
+  uint8_t missed = 0;
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if ((slots & (1 << i)) && !this->notifyHost(i, m, length))
+    {
+      this->reportsFailed++;
+      missed |= 1 << i;
+    }
+  }
+  return missed;
+}
+
+bool BleMouse::notifyHost(uint8_t slot, uint8_t *m, uint8_t length)
+{
+  // A confirmation that came after an earlier attempt timed out is stale
+  xSemaphoreTake(notifyDone, 0);
+
+  esp_gatt_if_t gattsIf = this->connectionStatus.server->getGattsIf();
+  uint16_t connId = this->connectionStatus.hosts[slot].connId;
+  if (esp_ble_gatts_send_indicate(gattsIf, connId, inputHandle, length, m, false) != ESP_OK)
+    return false;
+
+  if (xSemaphoreTake(notifyDone, pdMS_TO_TICKS(MOUSE_NOTIFY_TIMEOUT)) != pdTRUE)
+    return false;
+  return notifyStatus == ESP_GATT_OK;
+}
+
+void BleMouse::taskReports(void* pvParameter) {
+  BleMouse* bleMouseInstance = (BleMouse *) pvParameter;
+  MouseReport report;
+
+  for (;;)
+  {
+    if (!bleMouseInstance->pop(report))
+    {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    // Reports meant to go out together become one notification
+    while (report.delay == 0 && bleMouseInstance->mergeNext(report))
+      bleMouseInstance->reportsCoalesced++;
+
+    bleMouseInstance->send(report);
+
+    if (report.delay > 0)
+      vTaskDelay(pdMS_TO_TICKS(bleMouseInstance->alignToConnection(report.delay)));
+  }
+}
+
+void BleMouse::buttons(uint8_t b)
+{
+  if (b != _buttons)
+  {
+    _buttons = b;
+    move(0,0,0,0);
+  }
+}
+
+void BleMouse::press(uint8_t b)
+{
+  buttons(_buttons | b);
+}
+
+void BleMouse::release(uint8_t b)
+{
+  buttons(_buttons & ~b);
+}
+
+bool BleMouse::isPressed(uint8_t b)
+{
+  if ((b & _buttons) > 0)
+    return true;
+  return false;
+}
+
+bool BleMouse::isConnected(void) {
+  // Written by the BLE task on the other core
+  return __atomic_load_n(&this->connectionStatus.connected, __ATOMIC_ACQUIRE);
+}
+
+uint8_t BleMouse::hosts(void) {
+  return __atomic_load_n(&this->connectionStatus.hostMask, __ATOMIC_ACQUIRE);
+}
+
+void BleMouse::disconnectAll(void) {
+  this->connectionStatus.disconnectAll();
+}
+
+void BleMouse::setBatteryLevel(uint8_t level) {
+  this->batteryLevel = level;
+  if (hid != 0)
+      this->hid->setBatteryLevel(this->batteryLevel);
+}
+
+uint32_t BleMouse::reconnectLatency(void) {
+  return this->connectionStatus.reconnectLatency;
+}
+
+uint16_t BleMouse::reconnects(void) {
+  return this->connectionStatus.reconnects;
+}
+
+void BleMouse::setConnectionCallback(void (*callback)(void)) {
+  this->connectionStatus.callback = callback;
+}
+
+void BleMouse::setSentCallback(void (*callback)(const MouseReport &report)) {
+  this->sentCallback = callback;
+}
+
+#if defined(PROBES) && PROBES
+void BleMouse::setSendProbe(void (*probe)(uint32_t us)) {
+  this->sendProbe = probe;
+}
+#endif
+
+void BleMouse::requestConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+  this->connectionStatus.requestUpdate(minInterval, maxInterval, latency, timeout);
+}
+
+uint16_t BleMouse::connInterval(uint8_t host) {
+  return this->connectionStatus.hosts[host].interval;
+}
+
+uint16_t BleMouse::connLatency(uint8_t host) {
+  return this->connectionStatus.hosts[host].latency;
+}
+
+uint16_t BleMouse::connTimeout(uint8_t host) {
+  return this->connectionStatus.hosts[host].timeout;
+}
+
+uint32_t BleMouse::connUpdateTime(uint8_t host) {
+  return this->connectionStatus.hosts[host].updateTime;
+}
+
+bool BleMouse::connUpdatePending(void) {
+  for (int i = 0; i < BLE_MAX_HOSTS; i++)
+  {
+    if (this->connectionStatus.hosts[i].connected && this->connectionStatus.hosts[i].updateRequestedAt != 0)
+      return true;
+  }
+  return false;
+}
+
+void BleMouse::readRssi(void) {
+  this->connectionStatus.readRssi();
+}
+
+int8_t BleMouse::rssi(uint8_t host) {
+  return this->connectionStatus.hosts[host].rssi;
+}
+
+bool BleMouse::setTxPower(uint8_t host, int8_t dbm) {
+  return this->connectionStatus.setTxPower(host, dbm);
+}
+
+int8_t BleMouse::txPower(uint8_t host) {
+  return this->connectionStatus.hosts[host].txPower;
+}
+
+void BleMouse::gattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param) {
+  // Bluedroid confirms notifications too, with the status of the send
+  if (event == ESP_GATTS_CONF_EVT && param->conf.handle == inputHandle)
+  {
+    notifyStatus = param->conf.status;
+    xSemaphoreGive(notifyDone);
+  }
+}
+
+void BleMouse::gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (gapConnectionStatus == nullptr)
+    return;
+  if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT)
+    gapConnectionStatus->onUpdate(param);
+  else if (event == ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT)
+    gapConnectionStatus->onRssi(param);
+}
+
+void BleMouse::start(void) {
+  BLEDevice::init(this->deviceName);
+  gapConnectionStatus = &this->connectionStatus;
+  BLEDevice::setCustomGapHandler(gapHandler);
+  if (notifyDone == NULL)
+    notifyDone = xSemaphoreCreateBinaryStatic(&notifyDoneBuffer);
+  BLEDevice::setCustomGattsHandler(gattsHandler);
+  BLEServer *pServer = BLEDevice::createServer();
+  pServer->setCallbacks(&this->connectionStatus);
+
+  this->hid = new (hidStorage) BLEHIDDevice(pServer);
+  bool wide = this->format == MOUSE_FORMAT_16BIT;
+  this->inputMouse = this->hid->inputReport(wide ? REPORT_ID_MOUSE : 0); // <-- input REPORTID from report map
+  this->connectionStatus.inputMouse = this->inputMouse;
+  if (wide)
+  {
+    uint8_t multiplier = 0;
+    this->featureMouse = this->hid->featureReport(REPORT_ID_RESOLUTION);
+    this->featureMouse->setValue(&multiplier, 1);
+    this->connectionStatus.featureMouse = this->featureMouse;
+  }
+
+  this->hid->manufacturer()->setValue(this->deviceManufacturer);
+
+  //this->hid->pnp(0x02, 0xe502, 0xa111, 0x0210);
+
+  // Logitech M510 Identifiers
+  this->hid->pnp(0x02, 0x046D, 0xC52B, 0x0001);
+
+  this->hid->hidInfo(0x00,0x02);
+
+  security.setAuthenticationMode(ESP_LE_AUTH_BOND);
+
+  if (wide)
+    this->hid->reportMap((uint8_t*)_hidReportDescriptor16, sizeof(_hidReportDescriptor16));
+  else
+    this->hid->reportMap((uint8_t*)_hidReportDescriptor, sizeof(_hidReportDescriptor));
+  this->hid->startServices();
+  inputHandle = this->inputMouse->getHandle();  // Assigned once the service started
+
+  this->onStarted(pServer);
+
+  BLEAdvertising *pAdvertising = pServer->getAdvertising();
+  pAdvertising->setAppearance(HID_MOUSE);
+  pAdvertising->addServiceUUID(this->hid->hidService()->getUUID());
+  pAdvertising->start();
+  this->hid->setBatteryLevel(this->batteryLevel);
+
+  ESP_LOGD(LOG_TAG, "Advertising started!");
+}
@@ -0,0 +1,124 @@
+#ifndef ESP32_BLE_MOUSE_H
+#define ESP32_BLE_MOUSE_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include "BleConnectionStatus.h"
+#include "BLEHIDDevice.h"
+#include "BLECharacteristic.h"
+#include "MouseQueue.h"
+
+#define MOUSE_LEFT 1
+#define MOUSE_RIGHT 2
+#define MOUSE_MIDDLE 4
+#define MOUSE_BACK 8
+#define MOUSE_FORWARD 16
+#define MOUSE_ALL (MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE) # For compatibility with the Mouse library
+
+// Connection TX power the controller offers, dBm
+#define MOUSE_TX_MIN_DBM -12
+#define MOUSE_TX_MAX_DBM 9
+#define MOUSE_TX_STEP_DB 3
+#define MOUSE_TX_DEFAULT_DBM 3
+
+#define MOUSE_TASK_STACK 3072  // Report task, bytes
+#define MOUSE_NOTIFY_TIMEOUT 50  // ms to wait for the stack to confirm a notification
+
+class BleMouse {
+private:
+  uint8_t _buttons;
+  BleConnectionStatus connectionStatus;
+  BLEHIDDevice* hid;
+  BLECharacteristic* inputMouse;
+  BLECharacteristic* featureMouse;  // Resolution Multiplier, 16-bit format only
+  uint8_t format;
+  MouseQueue queue;
+  portMUX_TYPE queueMux;
+  TaskHandle_t reportTask;
+  StaticTask_t reportTaskBuffer;
+  StackType_t reportStack[MOUSE_TASK_STACK];
+#if defined(PROBES) && PROBES
+  void (*sendProbe)(uint32_t us);
+#endif
+  void (*sentCallback)(const MouseReport &report);
+  bool pop(MouseReport &report);
+  bool mergeNext(MouseReport &report);
+  uint32_t alignToConnection(uint32_t delay);
+  void send(const MouseReport &report);
+  uint8_t notifyHosts(uint8_t slots, uint8_t *m, uint8_t length);
+  bool notifyHost(uint8_t slot, uint8_t *m, uint8_t length);
+  static void taskReports(void* pvParameter);
+  void buttons(uint8_t b);
+  void rawAction(uint8_t msg[], char msgSize);
+  void start(void);
+  static void gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+  static void gattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param);
+public:
+  // The names are not copied, pass strings that live as long as the mouse
+  BleMouse(const char* deviceName = "ESP32 Bluetooth Mouse", const char* deviceManufacturer = "Espressif", uint8_t batteryLevel = 100);
+  void setDeviceName(const char* name) { this->deviceName = name; }  // Before begin(), kept by pointer
+  // Before begin(), MOUSE_FORMAT_8BIT by default
+  void setReportFormat(uint8_t format);
+  uint8_t reportFormat(void);
+  int16_t axisLimit(void);        // Largest value a report can carry per axis
+  uint8_t wheelResolution(void);  // Wheel units per notch, as the hosts set it
+  void begin(void);
+  void end(void);
+  void click(uint8_t b = MOUSE_LEFT);
+  void move(signed char x, signed char y, signed char wheel = 0, signed char hWheel = 0);
+  void press(uint8_t b = MOUSE_LEFT);   // press LEFT by default
+  void release(uint8_t b = MOUSE_LEFT); // release LEFT by default
+  bool isPressed(uint8_t b = MOUSE_LEFT); // check LEFT by default
+  bool isConnected(void);  // To any host
+  uint8_t hosts(void);     // Bit per connected host slot, up to BLE_MAX_HOSTS
+  void disconnectAll(void);
+  void setBatteryLevel(uint8_t level);
+  uint32_t reconnectLatency(void);
+  uint16_t reconnects(void);
+  void setConnectionCallback(void (*callback)(void));
+
+  // Ask every connected central for new connection parameters, interval in
+  // units of 1.25 ms, latency in connection events, timeout in units of 10 ms
+  void requestConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+  uint16_t connInterval(uint8_t host);
+  uint16_t connLatency(uint8_t host);
+  uint16_t connTimeout(uint8_t host);
+  uint32_t connUpdateTime(uint8_t host);
+  bool connUpdatePending(void);  // For any host
+
+  // Link quality. readRssi() asks the controller about every host, rssi()
+  // has the answer once it came in (dBm, 0 before the first). TX power is
+  // per connection, rounded to the controller's steps.
+  void readRssi(void);
+  int8_t rssi(uint8_t host);
+  bool setTxPower(uint8_t host, int8_t dbm);
+  int8_t txPower(uint8_t host);
+
+  // Queue reports to be sent in the background, paced by their delays and
+  // aligned to connection events. All or nothing, false if they do not fit.
+  bool enqueue(const MouseReport *queued, uint8_t count);
+  uint8_t queued(void);
+  void clearQueue(void);
+  volatile uint32_t reportsSent;
+  volatile uint32_t reportsCoalesced;
+  volatile uint32_t reportsDropped;  // Queue full or link gone before sending
+  volatile uint32_t reportsFailed;   // Notifications to a host the stack did not deliver
+  volatile uint32_t reportsRetried;  // Notifications sent again to a host that missed one
+  volatile uint32_t reportsLost;     // Reports a host still missed after MOUSE_RETRY_MAX retries
+#if defined(PROBES) && PROBES
+  // Called from the report task with the microseconds each notification took
+  void setSendProbe(void (*probe)(uint32_t us));
+#endif
+  // Called from the report task with every report that went out, after the
+  // notification. Keep it short, the next report waits for it.
+  void setSentCallback(void (*callback)(const MouseReport &report));
+  uint32_t reportStackFree(void);  // Report task stack never used so far, bytes
+  uint8_t batteryLevel;
+  const char* deviceManufacturer;
+  const char* deviceName;
+protected:
+  virtual void onStarted(BLEServer *pServer) { };
+};
+
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_BLE_MOUSE_H
@@ -0,0 +1,147 @@
+#ifndef ESP32_BLE_MOUSE_QUEUE_H
+#define ESP32_BLE_MOUSE_QUEUE_H
+
+// The parts of BleMouse that do not talk to the stack: report format, the
+// report ring, merging and pacing. Header only and free of ESP-IDF, so the
+// simulator's BleMouse runs the same code.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Report maps. The 8-bit one is the 5-byte report every host understands.
+// The 16-bit one has report IDs, 16-bit axes and a Resolution Multiplier for
+// the wheels, hosts that never set the multiplier get whole notches. Hosts
+// cache the map with the pairing, switching needs them to pair again.
+#define MOUSE_FORMAT_8BIT 0
+#define MOUSE_FORMAT_16BIT 1
+#define MOUSE_WHEEL_MULTIPLIER 8  // Wheel units per notch once a host enables high resolution
+
+// One queued HID report and how long to wait after sending it before the
+// next one goes out. Reports with no delay may be merged with the next.
+// Axes are clamped to the format's range, wheels count in wheelResolution()
+// units per notch.
+struct MouseReport {
+  uint8_t buttons;
+  int16_t x;
+  int16_t y;
+  int16_t wheel;
+  int16_t hWheel;
+  uint16_t delay;
+};
+
+#define MOUSE_QUEUE_SIZE 32
+#define MOUSE_REPORT_MAX 9  // Bytes of the largest encoded report
+#define MOUSE_RETRY_MAX 3   // Connection events a report waits for a host that missed it
+
+// Largest value a report can carry per axis
+inline int16_t mouseAxisLimit(uint8_t format)
+{
+  return format == MOUSE_FORMAT_16BIT ? 32767 : 127;
+}
+
+// Wheel units per notch for the Resolution Multiplier feature byte
+inline uint8_t mouseWheelResolution(uint8_t feature)
+{
+  return (feature & 0x03) ? MOUSE_WHEEL_MULTIPLIER : 1;
+}
+
+// The notification payload, little endian words in the 16-bit format. The
+// report ID is implied by the characteristic. Returns the length.
+inline uint8_t mouseEncode(const MouseReport &report, uint8_t format, uint8_t *m)
+{
+  int limit = mouseAxisLimit(format);
+  const int16_t axes[] = { report.x, report.y, report.wheel, report.hWheel };
+  uint8_t length = 0;
+  m[length++] = report.buttons;
+  for (int16_t axis : axes)
+  {
+    int16_t value = axis < -limit ? -limit : axis > limit ? limit : axis;
+    m[length++] = value & 0xff;
+    if (format == MOUSE_FORMAT_16BIT)
+      m[length++] = value >> 8;
+  }
+  return length;
+}
+
+// Round up to whole connection intervals (units of 1.25 ms), so reports
+// leave one per connection event instead of bunching up in some and missing
+// others. Without a connection the delay stays as it is.
+inline uint32_t mouseAlignToConnection(uint32_t delay, uint16_t interval)
+{
+  uint32_t period = interval * 1250;  // Microseconds
+  if (period == 0)
+    return delay;
+
+  uint32_t events = (delay * 1000 + period - 1) / period;
+  return events * period / 1000;
+}
+
+// Reports waiting to be sent. Not locked, BleMouse holds its spinlock
+// around every call.
+class MouseQueue {
+public:
+  // All or nothing, false if they do not fit
+  bool push(const MouseReport *queued, uint8_t count)
+  {
+    if (this->used() + count >= MOUSE_QUEUE_SIZE)
+      return false;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      this->reports[this->head] = queued[i];
+      this->head = (this->head + 1) & (MOUSE_QUEUE_SIZE - 1);
+    }
+    return true;
+  }
+
+  bool pop(MouseReport &report)
+  {
+    if (this->tail == this->head)
+      return false;
+
+    report = this->reports[this->tail];
+    this->tail = (this->tail + 1) & (MOUSE_QUEUE_SIZE - 1);
+    return true;
+  }
+
+  // Takes the next report into this one if the buttons are the same and
+  // every axis still fits the report
+  bool mergeNext(MouseReport &report, int limit)
+  {
+    if (this->tail == this->head)
+      return false;
+
+    const MouseReport &next = this->reports[this->tail];
+    int x = report.x + next.x;
+    int y = report.y + next.y;
+    int wheel = report.wheel + next.wheel;
+    int hWheel = report.hWheel + next.hWheel;
+    if (next.buttons != report.buttons || abs(x) > limit || abs(y) > limit || abs(wheel) > limit || abs(hWheel) > limit)
+      return false;
+
+    report.x = x;
+    report.y = y;
+    report.wheel = wheel;
+    report.hWheel = hWheel;
+    report.delay = next.delay;
+    this->tail = (this->tail + 1) & (MOUSE_QUEUE_SIZE - 1);
+    return true;
+  }
+
+  uint8_t used(void) const
+  {
+    return (this->head - this->tail) & (MOUSE_QUEUE_SIZE - 1);
+  }
+
+  void clear(void)
+  {
+    this->tail = this->head;
+  }
+
+private:
+  MouseReport reports[MOUSE_QUEUE_SIZE];
+  uint8_t head = 0;
+  uint8_t tail = 0;
+};
+
+#endif // ESP32_BLE_MOUSE_QUEUE_H
@@ -0,0 +1,89 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core the firmware uses, backed
+// by the virtual clock and pin levels in sim.h.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <deque>
+#include "sim.h"
+
+using std::min;
+using std::max;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline uint32_t millis() { return sim.now; }  // 32 bits like on the ESP32, so it wraps after 49.7 days
+inline uint32_t micros() { return sim.now * 1000; }
+inline void delay(uint32_t ms) { sim.advance(ms); }
+
+// Like the real core, setting up a pin as GPIO detaches it from LEDC
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin == sim.ledcPin)
+    {
+        sim.ledcPin = -1;
+        sim.ledcDetached++;
+    }
+}
+inline int digitalRead(uint8_t pin) { return sim.pins[pin]; }
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+
+// One PWM output, the backlight
+inline uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution) { return freq; }
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) { sim.ledcPin = pin; }
+inline void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (sim.ledcPin >= 0)
+    {
+        sim.backlight = duty;
+    }
+}
+
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) { sim.isr[pin] = handler; }
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud) {}
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t println(const char *text = "") { return print(text) + print('\n'); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    int available() { return input.size(); }
+    int read();
+    void flush() {}
+    void onReceive(void (*callback)(void)) { receive = callback; }
+
+    void feed(const char *text);  // Bytes from the host, as if typed into the port
+    void feed(const uint8_t *data, size_t size);
+    bool echo = false;            // Copy firmware output to stdout
+    FILE *capture = nullptr;      // and to this file
+
+private:
+    std::deque<uint8_t> input;
+    void (*receive)(void) = nullptr;
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,390 @@
+#pragma once
+
+// Host stand-in for BleMouse: the connection is whatever the simulator says,
+// and every report is logged with its virtual timestamp.
+
+#include <chrono>
+#include <string>
+#include "Arduino.h"
+#include "../lib/BleMouse/MouseQueue.h"  // The library's own queue, merging and pacing
+
+#define MOUSE_TX_MIN_DBM -12
+#define MOUSE_TX_MAX_DBM 9
+#define MOUSE_TX_STEP_DB 3
+#define MOUSE_TX_DEFAULT_DBM 3
+
+class BleMouse
+{
+public:
+    BleMouse(const char* deviceName = "ESP32 Bluetooth Mouse", const char* deviceManufacturer = "Espressif", uint8_t batteryLevel = 100) {}
+    void setDeviceName(const char* name) {}
+
+    // The multiplier is one feature value for all hosts. Like the library,
+    // each new host resets it and then sets it again if sim.hostHiRes says so.
+    void setReportFormat(uint8_t format) { this->format = format; }
+    uint8_t reportFormat(void) { return format; }
+    int16_t axisLimit(void) { return mouseAxisLimit(format); }
+    uint8_t wheelResolution(void) { hosts(); return format == MOUSE_FORMAT_16BIT ? mouseWheelResolution(feature) : 1; }
+    void begin(void) { started = true; instance = this; sim.background = drain; }
+    void end(void) {}
+    bool isConnected(void) { return hosts() != 0; }
+    uint8_t hosts(void);
+    void disconnectAll(void);
+    uint32_t reconnectLatency(void) { return latency; }
+    uint16_t reconnects(void) { return count; }
+    void setConnectionCallback(void (*callback)(void)) { sim.connectionCallback = callback; }
+
+    // Every central accepts every request, two connection events later
+    void requestConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+    uint16_t connInterval(uint8_t host) { settle(host); return link[host].params[0]; }
+    uint16_t connLatency(uint8_t host) { settle(host); return link[host].params[1]; }
+    uint16_t connTimeout(uint8_t host) { settle(host); return link[host].params[2]; }
+    uint32_t connUpdateTime(uint8_t host) { settle(host); return link[host].updateTime; }
+    bool connUpdatePending(void);
+
+    // Readings come straight from the simulator, the host receives at our
+    // power plus the same path loss
+    void readRssi(void);
+    int8_t rssi(uint8_t host) { return link[host].rssi; }
+    bool setTxPower(uint8_t host, int8_t dbm);
+    int8_t txPower(uint8_t host) { return link[host].txPower; }
+
+    void move(signed char x, signed char y, signed char wheel = 0, signed char hWheel = 0)
+    {
+        if (isConnected())
+        {
+            MouseReport report = { 0, x, y, wheel, hWheel, 0 };
+            enqueue(&report, 1);
+        }
+    }
+
+    // Same pacing as the report task: delays round up to connection events,
+    // reports without a delay merge with the next one while the sums fit
+    bool enqueue(const MouseReport *queued, uint8_t count);
+    uint8_t queued(void) { return queue.used(); }
+    void clearQueue(void) { queue.clear(); }
+    uint32_t reportsSent = 0;
+    uint32_t reportsCoalesced = 0;
+    uint32_t reportsDropped = 0;
+    uint32_t reportsFailed = 0;
+    uint32_t reportsRetried = 0;
+    uint32_t reportsLost = 0;
+    void setSentCallback(void (*callback)(const MouseReport &report)) { sentCallback = callback; }
+    uint32_t reportStackFree(void) { return 0; }
+#if PROBES
+    void setSendProbe(void (*probe)(uint32_t us)) { sendProbe = probe; }
+#endif
+
+private:
+    struct Link {
+        bool connected = false;
+        uint16_t params[3] = { 0, 0, 0 };
+        uint16_t pending[3];
+        uint32_t updateAt = 0;
+        uint32_t requestedAt = 0;
+        uint32_t updateTime = 0;
+        int8_t rssi = 0;
+        int8_t txPower = MOUSE_TX_DEFAULT_DBM;
+    };
+
+    bool started = false;
+    uint8_t format = MOUSE_FORMAT_8BIT;
+    uint8_t feature = 0;  // Resolution Multiplier as the hosts last wrote it
+    uint8_t mask = 0;
+    Link link[BLE_MAX_HOSTS];
+    uint32_t disconnectedAt = 0;
+    uint32_t latency = 0;
+    uint16_t count = 0;
+    MouseQueue queue;
+    MouseReport missed;       // Report still owed to the hosts in missedHosts
+    uint8_t missedHosts = 0;
+    uint8_t tries = 0;        // Retries of it so far
+    uint32_t missedSince = 0; // Its sinceSent when it first went out
+    uint64_t nextSend = 0;
+    uint32_t lastSent = 0;
+    uint32_t noise = 0;
+    static inline BleMouse *instance = nullptr;
+#if PROBES
+    void (*sendProbe)(uint32_t us) = nullptr;
+#endif
+    void (*sentCallback)(const MouseReport &report) = nullptr;
+
+    void settle(uint8_t host);
+    uint16_t slowestInterval();
+    bool deliver(uint8_t host, const MouseReport &report);
+    uint8_t deliverTo(uint8_t hosts, const MouseReport &report);
+    void send();
+    void retry();
+    void schedule();
+    static uint64_t drain();
+};
+
+inline uint8_t BleMouse::hosts(void)
+{
+    uint8_t now = 0;
+
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        bool up = started && sim.hostConnected[host];
+        if (up && !link[host].connected)
+        {
+            // Typical central defaults: 30 ms, no latency, 4 s timeout
+            link[host].params[0] = 24;
+            link[host].params[1] = 0;
+            link[host].params[2] = 400;
+            link[host].updateAt = 0;
+            link[host].rssi = 0;
+            link[host].txPower = MOUSE_TX_DEFAULT_DBM;
+            feature = sim.hostHiRes[host] ? 1 : 0;
+        }
+        link[host].connected = up;
+        now |= up << host;
+    }
+
+    // Same reconnect bookkeeping as BleConnectionStatus
+    if (!now && mask)
+    {
+        disconnectedAt = sim.now | 1;
+    }
+    else if (now && !mask && disconnectedAt != 0)
+    {
+        latency = sim.now - disconnectedAt;
+        count++;
+        disconnectedAt = 0;
+    }
+    mask = now;
+
+    return now;
+}
+
+inline void BleMouse::disconnectAll(void)
+{
+    // The simulator's host schedule brings them back
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        sim.hostConnected[host] = false;
+    }
+    if (sim.connectionCallback)
+    {
+        sim.connectionCallback();
+    }
+}
+
+inline void BleMouse::requestConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout)
+{
+    uint8_t connected = hosts();
+
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if (!(connected & (1 << host)))
+        {
+            continue;
+        }
+
+        Link &l = link[host];
+        settle(host);
+        l.pending[0] = maxInterval;
+        l.pending[1] = latency;
+        l.pending[2] = timeout;
+        l.requestedAt = sim.now;
+        l.updateAt = (sim.now + 2 * l.params[0] * 5 / 4) | 1;
+    }
+}
+
+inline bool BleMouse::connUpdatePending(void)
+{
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        settle(host);
+        if (link[host].connected && link[host].updateAt != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void BleMouse::readRssi(void)
+{
+    uint8_t connected = hosts();
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if (connected & (1 << host))
+        {
+            link[host].rssi = sim.hostRssi[host];
+        }
+    }
+}
+
+inline bool BleMouse::setTxPower(uint8_t host, int8_t dbm)
+{
+    if (!(hosts() & (1 << host)))
+    {
+        return false;
+    }
+    int level = (constrain(dbm, MOUSE_TX_MIN_DBM, MOUSE_TX_MAX_DBM) - MOUSE_TX_MIN_DBM + MOUSE_TX_STEP_DB - 1) / MOUSE_TX_STEP_DB;
+    link[host].txPower = MOUSE_TX_MIN_DBM + level * MOUSE_TX_STEP_DB;
+    return true;
+}
+
+inline void BleMouse::settle(uint8_t host)
+{
+    Link &l = link[host];
+    if (l.updateAt != 0 && (int32_t)(sim.now - l.updateAt) >= 0)
+    {
+        memcpy(l.params, l.pending, sizeof(l.params));
+        l.updateTime = l.updateAt - l.requestedAt;
+        l.updateAt = 0;
+    }
+}
+
+inline uint16_t BleMouse::slowestInterval()
+{
+    uint16_t interval = 0;
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if (link[host].connected)
+        {
+            interval = max(interval, connInterval(host));
+        }
+    }
+    return interval;
+}
+
+inline bool BleMouse::enqueue(const MouseReport *queued, uint8_t count)
+{
+    if (!queue.push(queued, count))
+    {
+        reportsDropped += count;
+        return false;
+    }
+    return true;
+}
+
+inline bool BleMouse::deliver(uint8_t host, const MouseReport &report)
+{
+    // Own generator, the firmware's random() sequence stays the same
+    noise = noise * 1664525 + 1013904223 + sim.seed;
+    int received = link[host].txPower + sim.hostRssi[host] + (int)(noise >> 29) - 4;
+    if (received < SIM_HOST_SENSITIVITY)
+    {
+        return false;
+    }
+
+    SimReport sent = { sim.now, sim.hostLink[host], host, connInterval(host),
+        report.x, report.y, report.wheel, sim.now - lastSent, 0, sim.elapsed };
+    sent.tx = link[host].txPower;
+    sim.reports.push_back(sent);
+    return true;
+}
+
+inline uint8_t BleMouse::deliverTo(uint8_t hosts, const MouseReport &report)
+{
+    uint8_t failed = 0;
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if ((hosts & (1 << host)) && !deliver(host, report))
+        {
+            reportsFailed++;
+            failed |= 1 << host;
+        }
+    }
+    return failed;
+}
+
+inline void BleMouse::send()
+{
+    MouseReport report;
+    if (!queue.pop(report))
+    {
+        return;
+    }
+    while (report.delay == 0 && queue.mergeNext(report, axisLimit()))
+    {
+        reportsCoalesced++;
+    }
+
+    uint8_t connected = hosts();
+    if (!connected)
+    {
+        reportsDropped++;
+        return;
+    }
+
+    // One notification per central, timed on the wall clock like halTimerUs()
+#if PROBES
+    auto started = std::chrono::steady_clock::now();
+#endif
+    missedHosts = deliverTo(connected, report);
+    reportsSent++;
+    missedSince = sim.now - lastSent;
+    lastSent = sim.now;
+#if PROBES
+    if (sendProbe)
+    {
+        sendProbe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count());
+    }
+#endif
+    if (sentCallback)
+    {
+        sentCallback(report);
+    }
+
+    missed = report;
+    tries = 0;
+    schedule();
+}
+
+inline void BleMouse::retry()
+{
+    uint8_t again = missedHosts & hosts();
+    reportsRetried += __builtin_popcount(again);
+    missedHosts = deliverTo(again, missed);
+    tries++;
+    schedule();
+}
+
+// Same as the report task: a host that missed the report gets it again one
+// connection event later until it has it, has left or MOUSE_RETRY_MAX tries
+// are used up, the next report waits
+inline void BleMouse::schedule()
+{
+    missedHosts &= hosts();
+    if (missedHosts != 0 && tries == MOUSE_RETRY_MAX)
+    {
+        for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+        {
+            if (missedHosts & (1 << host))
+            {
+                // Logged as the first try would have been
+                sim.lost.push_back({ lastSent, sim.hostLink[host], host, connInterval(host),
+                    missed.x, missed.y, missed.wheel, missedSince, 0, sim.elapsed });
+                reportsLost++;
+            }
+        }
+        missedHosts = 0;
+    }
+    if (missedHosts != 0)
+    {
+        nextSend = sim.elapsed + mouseAlignToConnection(1, slowestInterval());
+        return;
+    }
+    nextSend = sim.elapsed + mouseAlignToConnection(missed.delay, slowestInterval());
+}
+
+inline uint64_t BleMouse::drain()
+{
+    BleMouse *mouse = instance;
+    while ((mouse->queue.used() > 0 || mouse->missedHosts != 0) && mouse->nextSend <= sim.elapsed)
+    {
+        if (mouse->missedHosts != 0)
+        {
+            mouse->retry();
+        }
+        else
+        {
+            mouse->send();
+        }
+    }
+    return mouse->queue.used() == 0 && mouse->missedHosts == 0 ? UINT64_MAX : mouse->nextSend;
+}
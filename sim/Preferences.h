@@ -0,0 +1,79 @@
+#pragma once
+
+// Host stand-in for Preferences, stored in the simulator's NVS map so values
+// survive a simulated restart.
+
+#include <string>
+#include "Arduino.h"
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false) { ns = name; return true; }
+    void end() {}
+
+    bool getBool(const char *key, bool defaultValue = false) { return get<bool>(key, defaultValue); }
+    int16_t getShort(const char *key, int16_t defaultValue = 0) { return get<int16_t>(key, defaultValue); }
+    uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return get<uint16_t>(key, defaultValue); }
+    size_t putBool(const char *key, bool value) { return put(key, value); }
+    size_t putShort(const char *key, int16_t value) { return put(key, value); }
+    size_t putUShort(const char *key, uint16_t value) { return put(key, value); }
+    bool isKey(const char *key) { return sim.nvs.count(ns + "/" + key) != 0; }
+    bool remove(const char *key) { return sim.nvs.erase(ns + "/" + key) != 0; }
+
+    size_t getBytes(const char *key, void *buffer, size_t length)
+    {
+        auto it = sim.nvs.find(ns + "/" + key);
+        if (it == sim.nvs.end() || it->second.size() > length)
+        {
+            return 0;
+        }
+        memcpy(buffer, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t putBytes(const char *key, const void *value, size_t length)
+    {
+        const uint8_t *bytes = (const uint8_t *)value;
+        sim.nvs[ns + "/" + key].assign(bytes, bytes + length);
+        sim.nvsWrites++;
+        if (sim.traceNvs)
+        {
+            printf("%10llu ms  %s/%s =", (unsigned long long)sim.elapsed, ns.c_str(), key);
+            for (size_t i = 0; i < length; i++)
+            {
+                printf(" %02x", bytes[i]);
+            }
+            printf("\n");
+        }
+        return length;
+    }
+
+private:
+    std::string ns;
+
+    template <typename T> T get(const char *key, T defaultValue)
+    {
+        auto it = sim.nvs.find(ns + "/" + key);
+        if (it == sim.nvs.end() || it->second.size() != sizeof(T))
+        {
+            return defaultValue;
+        }
+
+        T value;
+        memcpy(&value, it->second.data(), sizeof(T));
+        return value;
+    }
+
+    template <typename T> size_t put(const char *key, T value)
+    {
+        const uint8_t *bytes = (const uint8_t *)&value;
+        sim.nvs[ns + "/" + key].assign(bytes, bytes + sizeof(T));
+        sim.nvsWrites++;
+        if (sim.traceNvs)
+        {
+            printf("%10llu ms  %s/%s = %lld\n", (unsigned long long)sim.elapsed, ns.c_str(), key, (long long)value);
+        }
+        return sizeof(T);
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+// Host stand-in for TFT_eSPI: draws into a framebuffer in RAM, so the cost of
+// a frame can be measured, and counts the pixels each call would send over
+// SPI so render changes can be compared without a panel.
+
+#include <vector>
+#include "Arduino.h"
+
+#define TFT_BL 4  // As in User_Setup.h
+
+#define TFT_BLACK       0x0000
+#define TFT_BLUE        0x001F
+#define TFT_RED         0xF800
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+
+#define TFT_SLPIN       0x10
+#define TFT_SLPOUT      0x11
+
+class TFT_eSPI
+{
+public:
+    TFT_eSPI(int16_t w = 135, int16_t h = 240) : _width(w), _height(h), pixels((size_t)w * h) {}
+
+    // Like TFT_eSPI built with TFT_BL in User_Setup.h, which turns the
+    // backlight on as plain GPIO
+    void init()
+    {
+        pinMode(TFT_BL, OUTPUT);
+        digitalWrite(TFT_BL, HIGH);
+    }
+    void writecommand(uint8_t c);
+    void setRotation(uint8_t r);
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color);
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color);
+    void setTextSize(uint8_t s) { textSize = s; }
+    void setTextColor(uint16_t color) { textColor = color; }
+    void setTextColor(uint16_t fg, uint16_t bg) { textColor = fg; }
+    void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+    size_t print(const char *text);
+    size_t print(char c) { char s[2] = { c, 0 }; return print(s); }
+
+    // Like the real one with setSwapBytes(false): data is sent as it is in
+    // memory, high byte first on the wire
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+    uint16_t readPixel(int32_t x, int32_t y) const { return pixels[(size_t)y * _width + x]; }
+
+protected:
+    int16_t _width, _height;
+    uint8_t textSize = 1;
+    uint16_t textColor = TFT_WHITE;
+    int16_t cursorX = 0, cursorY = 0;
+    std::vector<uint16_t> pixels;  // Row major, _width per row
+
+    // Sprites draw into RAM, only pushSprite() reaches the panel
+    virtual void drawn(uint32_t count);
+    friend class TFT_eSprite;
+};
+
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+    TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI(0, 0), parent(tft) {}
+
+    void setColorDepth(int8_t b) {}
+    void *createSprite(int16_t w, int16_t h) { _width = w; _height = h; pixels.assign((size_t)w * h, 0); return this; }
+    void deleteSprite() { pixels.clear(); _width = _height = 0; }
+    void fillSprite(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+    void pushSprite(int32_t x, int32_t y) { pushSprite(x, y, 0, 0, _width, _height); }
+    bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+protected:
+    TFT_eSPI *parent;
+
+    void drawn(uint32_t count) override {}
+};
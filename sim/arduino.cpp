@@ -0,0 +1,82 @@
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+// Same xorshift on every host so a seed always replays the same run
+static uint32_t randomState = 1;
+
+void randomSeed(unsigned long seed)
+{
+    randomState = seed ? seed : 1;
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+    {
+        return 0;
+    }
+
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+
+    return random(howbig - howsmall) + howsmall;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (echo)
+    {
+        fwrite(buffer, 1, size, stdout);
+    }
+    if (capture)
+    {
+        fwrite(buffer, 1, size, capture);
+    }
+    return size;
+}
+
+int HardwareSerial::read()
+{
+    if (input.empty())
+    {
+        return -1;
+    }
+    uint8_t c = input.front();
+    input.pop_front();
+    return c;
+}
+
+void HardwareSerial::feed(const char *text)
+{
+    feed((const uint8_t *)text, strlen(text));
+}
+
+void HardwareSerial::feed(const uint8_t *data, size_t size)
+{
+    input.insert(input.end(), data, data + size);
+    if (receive)
+    {
+        receive();
+    }
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return write((const uint8_t *)buffer, min((size_t)len, sizeof(buffer) - 1));
+}
@@ -0,0 +1,407 @@
+// Host micro-benchmarks, run with --bench. Timings are for this machine and
+// only meaningful relative to each other or to an earlier run on it. Every
+// metric has a budget, the run fails when one is exceeded. The defaults below
+// are loose enough for any recent PC, tighten them for a given machine with
+// --budgets FILE ("<metric> <limit>" per line).
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include <BleMouse.h>
+#include "config.h"
+#include "buttons.h"
+#include "jiggle.h"
+#if UI_DISPLAY
+#include "renderer.h"
+#endif
+#include "scheduler.h"
+#include "trace.h"
+
+struct Metric {
+    const char *name;
+    const char *unit;
+    double budget;  // Highest passing value
+    double value;
+};
+
+static Metric metrics[] = {
+    { "render_tick_ns", "ns/frame", 40000 },     // Countdown tick: spinner, countdown and bar
+    { "render_tick_px", "px/frame", 1000 },      // Pixels pushed for that frame
+    { "render_full_ns", "ns/frame", 100000 },    // Every widget redrawn
+    { "render_full_px", "px/frame", 13400 },
+    { "render_wrong_px", "px", 0 },              // Status pixels that differ from printing it with the font
+    { "button_edge_ns", "ns/edge", 200 },        // edge() and update() per bouncing edge
+    { "button_lost", "presses", 0 },             // Presses not reported
+    { "path_plan_ns", "ns/path", 3000 },
+    { "path_steps_max", "steps", JIGGLE_MAX_STEPS },
+    { "path_open", "paths", 0 },                 // Paths that do not return to start
+    { "schedule_ns", "ns/wakeup", 1000 },        // Arming every timer and a wait() that returns at once
+    { "schedule_missed", "posts", 0 },           // Posted events wait() did not return
+    { "trace_sent_ns", "ns/report", 50 },        // What the report task pays per report
+    { "trace_encode_ns", "ns/report", 200 },     // Moving it into the ring, in loop()
+    { "trace_bytes", "B/report", 5 },            // Ring space, from the first round
+    { "trace_wrong", "reports", 0 },             // Reports that decode differently
+    { "burst_notify_8", "notifies", 11 },         // A 1240 px move queued in 40 px steps, 8-bit reports
+    { "burst_notify_16", "notifies", 1 },         // The same with 16-bit reports
+};
+
+static const size_t numMetrics = sizeof(metrics) / sizeof(metrics[0]);
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void set(const char *name, double value)
+{
+    for (size_t i = 0; i < numMetrics; i++)
+    {
+        if (strcmp(metrics[i].name, name) == 0)
+        {
+            metrics[i].value = value;
+        }
+    }
+}
+
+static bool loadBudgets(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+
+    char line[128];
+    char name[64];
+    double limit;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || sscanf(line, "%63s %lf", name, &limit) != 2)
+        {
+            continue;
+        }
+
+        bool known = false;
+        for (size_t i = 0; i < numMetrics; i++)
+        {
+            if (strcmp(metrics[i].name, name) == 0)
+            {
+                metrics[i].budget = limit;
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            fprintf(stderr, "%s: unknown metric %s\n", path, name);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+#if UI_DISPLAY
+// Renders the status screen into the framebuffer of the fake display the
+// way render() in main.cpp does while the countdown runs. The status text
+// sits at (5, 5) as in renderer.h.
+static void benchRender(uint32_t count)
+{
+    static const char spinner[] = { '|', '/', '-', '\\' };
+    static const uint16_t colors[] = { TFT_RED, TFT_ORANGE, TFT_YELLOW, TFT_GREEN, TFT_CYAN, TFT_BLUE, TFT_MAGENTA };
+    const int interval = 300;
+
+    TFT_eSPI panel;
+    panel.setRotation(1);
+    Renderer renderer(panel);
+    sim.framebuffer = true;
+    renderer.begin();
+    renderer.setStatus("Jiggle", TFT_GREEN);
+    renderer.setFooter("J:12  I:300 H:1--");
+    renderer.setLink("R-67 T+3", TFT_GREEN);
+
+    char s[8];
+    auto tick = [&](uint32_t i)
+    {
+        int seconds = interval - i % interval;
+        snprintf(s, sizeof(s), "%c", spinner[i % 4]);
+        renderer.setSpinner(s, colors[i % 7]);
+        snprintf(s, sizeof(s), "%3ds", seconds);
+        renderer.setCountdown(s, seconds * 2 > interval ? TFT_GREEN : TFT_YELLOW);
+        renderer.setProgress((interval - seconds) * Renderer::barWidth / interval, TFT_GREEN);
+        renderer.push();
+        return renderer.lastFrame().pixels;
+    };
+
+    // The first frame draws everything, that is the full frame case below
+    tick(0);
+    uint64_t tickPixels = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        tickPixels += tick(i);
+    }
+    set("render_tick_ns", nanosecondsSince(start) / count);
+    set("render_tick_px", (double)tickPixels / count);
+
+    uint64_t fullPixels = 0;
+    uint32_t full = max(count / 10, (uint32_t)1);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < full; i++)
+    {
+        renderer.invalidate();
+        renderer.push();
+        fullPixels += renderer.lastFrame().pixels;
+    }
+    set("render_full_ns", nanosecondsSince(start) / full);
+    set("render_full_px", (double)fullPixels / full);
+
+    // Glyphs from the atlas must come out the same as the font drawn directly
+    TFT_eSprite expected(&panel);
+    expected.createSprite(108, 24);
+    expected.fillSprite(TFT_BLACK);
+    expected.setTextSize(3);
+    expected.setTextColor(TFT_GREEN);
+    expected.setCursor(0, 0);
+    expected.print("Jiggle");
+    uint32_t wrong = 0;
+    for (int16_t y = 0; y < 24; y++)
+    {
+        for (int16_t x = 0; x < 108; x++)
+        {
+            wrong += panel.readPixel(5 + x, 5 + y) != expected.readPixel(x, y);
+        }
+    }
+    set("render_wrong_px", wrong);
+    sim.framebuffer = false;
+}
+#endif
+
+// Presses with contact bounce on both ends, fed like the UI feeds the queue
+static void benchButtons(uint32_t count)
+{
+    Button button;
+    button.begin(HIGH);
+
+    uint32_t time = 1000;
+    uint32_t edges = 0;
+    uint32_t presses = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Bouncing press, held, bouncing release, then past the lockout
+        static const uint8_t levels[] = { LOW, HIGH, LOW, HIGH, LOW };
+        for (uint8_t level : levels)
+        {
+            button.edge(time, level);
+            presses += button.update(time) == BUTTON_PRESS;
+            time += 2;
+            edges++;
+        }
+        time += BUTTON_SETTLE + 100;
+        presses += button.update(time) == BUTTON_PRESS;
+        for (uint8_t level : levels)
+        {
+            button.edge(time, !level);
+            presses += button.update(time) == BUTTON_PRESS;
+            time += 2;
+            edges++;
+        }
+        time += BUTTON_SETTLE;
+        presses += button.update(time) == BUTTON_PRESS;
+        time += DEBOUNCE_DELAY;
+    }
+    set("button_edge_ns", nanosecondsSince(start) / edges);
+    set("button_lost", count - presses);
+}
+
+// Plans paths back to back and checks that every one closes exactly:
+// cursor and wheel end where they started
+static void benchPaths(uint32_t count)
+{
+    JiggleStep steps[JIGGLE_MAX_STEPS];
+    const JiggleParams params = JIGGLE_PARAMS_DEFAULT;
+    uint32_t open = 0;
+    uint32_t longest = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t n = Jiggle::plan(steps, params);
+        int x = 0, y = 0, wheel = 0;
+        for (uint8_t j = 0; j < n; j++)
+        {
+            x += steps[j].x;
+            y += steps[j].y;
+            wheel += steps[j].wheel;
+        }
+        open += (x != 0 || y != 0 || wheel != 0);
+        longest = max(longest, (uint32_t)n);
+    }
+    set("path_plan_ns", nanosecondsSince(start) / count);
+    set("path_steps_max", longest);
+    set("path_open", open);
+}
+
+// What loop() pays around every wakeup: re-arming the timers and checking
+// them in wait(). A post() makes wait() return without sleeping.
+static void benchSchedule(uint32_t count)
+{
+    Scheduler scheduler;
+    uint32_t missed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint8_t event = EVENT_UI; event < NUM_EVENTS; event++)
+        {
+            scheduler.arm(event, millis() + (event & 1));
+        }
+        scheduler.post(EVENT_COMMAND);
+        missed += !(scheduler.wait() & EVENT_BIT(EVENT_COMMAND));
+    }
+    set("schedule_ns", nanosecondsSince(start) / count);
+    set("schedule_missed", missed);
+    sim.woken = false;
+}
+
+// Jiggle-like reports through the trace, timed on both sides of the queue,
+// then decoded again. Each round is less than the queue holds, as in the
+// firmware where loop() drains it after every jiggle.
+static void benchTrace(uint32_t count)
+{
+    static Trace recorder;
+    static MouseReport reports[TRACE_QUEUE_SIZE / 2];
+    const uint32_t round = sizeof(reports) / sizeof(reports[0]);
+    uint32_t rounds = max(count / round, (uint32_t)1);
+    uint32_t time = 0;
+    double sentNs = 0;
+    double encodeNs = 0;
+
+    recorder.setState(time, 1, true, 180);
+    uint16_t stateBytes = recorder.used();
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        // The last round, the one checked, also has moves that need 16 bits
+        bool wide = i == rounds - 1;
+        for (MouseReport &report : reports)
+        {
+            int16_t range = wide && random(4) == 0 ? 2000 : 3;
+            report = { 0, (int16_t)random(-range, range + 1), (int16_t)random(-3, 4), (int16_t)(random(4) == 0), 0, 0 };
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (const MouseReport &report : reports)
+        {
+            time += 50;
+            recorder.sent(time, report);
+        }
+        sentNs += nanosecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        recorder.update();
+        encodeNs += nanosecondsSince(start);
+        if (i == 0)
+        {
+            set("trace_bytes", (double)(recorder.used() - stateBytes) / round);
+        }
+    }
+    set("trace_sent_ns", sentNs / (rounds * round));
+    set("trace_encode_ns", encodeNs / (rounds * round));
+
+    // The newest round is still in the ring, compare it from the end
+    TraceCursor cursor = recorder.first();
+    TraceRecord record;
+    uint32_t seen = 0;
+    uint32_t wrong = 0;
+    uint32_t firstOfRound = recorder.records - round;
+    while (recorder.next(cursor, record))
+    {
+        if (seen >= firstOfRound)
+        {
+            const MouseReport &expected = reports[seen - firstOfRound];
+            wrong += record.time != time - (round - 1 - (seen - firstOfRound)) * 50 ||
+                record.report.x != expected.x || record.report.y != expected.y || record.report.wheel != expected.wheel;
+        }
+        seen++;
+    }
+    set("trace_wrong", wrong);
+}
+
+// Moves queued without delays, as move() callers do, merged into as few
+// notifications as the report format's axis range allows. Runs the
+// library's own queue, the way its report task does.
+static void benchBurst()
+{
+    static const uint8_t formats[] = { MOUSE_FORMAT_8BIT, MOUSE_FORMAT_16BIT };
+    static const char *const names[] = { "burst_notify_8", "burst_notify_16" };
+
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        MouseQueue queue;
+        MouseReport steps[MOUSE_QUEUE_SIZE - 1];
+        for (MouseReport &step : steps)
+        {
+            step = { 0, 40, 0, 0, 0, 0 };
+        }
+        queue.push(steps, sizeof(steps) / sizeof(steps[0]));
+
+        uint32_t notifications = 0;
+        MouseReport report;
+        while (queue.pop(report))
+        {
+            while (report.delay == 0 && queue.mergeNext(report, mouseAxisLimit(formats[i])))
+            {
+            }
+            notifications++;
+        }
+        set(names[i], notifications);
+    }
+}
+
+int bench(uint32_t count, const char *budgets, bool json)
+{
+    if (budgets && !loadBudgets(budgets))
+    {
+        return 2;
+    }
+
+#if UI_DISPLAY
+    benchRender(count);
+#endif
+    benchButtons(count);
+    benchPaths(count);
+    benchSchedule(count);
+    benchTrace(count);
+    benchBurst();
+
+    bool pass = true;
+    for (size_t i = 0; i < numMetrics; i++)
+    {
+        const Metric &metric = metrics[i];
+        bool ok = metric.value <= metric.budget;
+        pass &= ok;
+
+        if (json)
+        {
+            printf("{\"metric\": \"%s\", \"value\": %.1f, \"unit\": \"%s\", \"budget\": %.1f, \"pass\": %s}\n",
+                metric.name, metric.value, metric.unit, metric.budget, ok ? "true" : "false");
+        }
+        else
+        {
+            printf("%-16s %12.1f %-10s budget %10.1f%s\n",
+                metric.name, metric.value, metric.unit, metric.budget, ok ? "" : "  OVER");
+        }
+    }
+
+    if (json)
+    {
+        printf("{\"result\": \"%s\"}\n", pass ? "PASS" : "FAIL");
+    }
+    else
+    {
+        printf("%s\n", pass ? "PASS" : "FAIL");
+    }
+    return pass ? 0 : 1;
+}
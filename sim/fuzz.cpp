@@ -0,0 +1,288 @@
+// Feeds the config protocol parser and the tunables store random and broken
+// input, run with --fuzz. Frames have to come through noise intact, broken
+// ones must never be taken, and no sequence of changes may leave a record
+// behind that does not pass its own checks.
+
+#include <stdio.h>
+#include <vector>
+#include "crc32.h"
+#include "protocol.h"
+#include "tunables.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes encode(const ConfigFrame &frame)
+{
+    Bytes bytes(5 + frame.length);
+    bytes[0] = CONFIG_FRAME_MAGIC0;
+    bytes[1] = CONFIG_FRAME_MAGIC1;
+    bytes[2] = frame.op;
+    bytes[3] = frame.seq;
+    bytes[4] = frame.length;
+    memcpy(bytes.data() + 5, frame.payload, frame.length);
+    uint32_t crc = crc32(bytes.data() + 2, bytes.size() - 2);
+    for (int i = 0; i < 4; i++)
+    {
+        bytes.push_back(crc >> (8 * i));
+    }
+    return bytes;
+}
+
+static ConfigFrame randomFrame()
+{
+    ConfigFrame frame;
+    frame.op = random(256);
+    frame.seq = random(256);
+    frame.length = random(CONFIG_PAYLOAD_MAX + 1);
+    for (uint8_t i = 0; i < frame.length; i++)
+    {
+        frame.payload[i] = random(256);
+    }
+    return frame;
+}
+
+static bool same(const ConfigFrame &a, const ConfigFrame &b)
+{
+    return a.op == b.op && a.seq == b.seq && a.length == b.length && memcmp(a.payload, b.payload, a.length) == 0;
+}
+
+// Valid frames with text in between, text never has the magic byte
+static bool fuzzFrames(uint32_t count)
+{
+    ConfigParser parser;
+    uint32_t now = 0;
+    uint32_t recovered = 0;
+    uint32_t mangled = 0;
+    uint32_t text = 0;
+    uint32_t sentText = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t noise = random(16);
+        for (uint8_t n = 0; n < noise; n++)
+        {
+            uint8_t c = random(255);
+            c += c >= CONFIG_FRAME_MAGIC0;
+            text += parser.feed(c, now++) == CONFIG_PARSE_TEXT;
+        }
+        sentText += noise;
+
+        ConfigFrame frame = randomFrame();
+        Bytes bytes = encode(frame);
+        uint32_t frames = 0;
+        for (size_t n = 0; n < bytes.size(); n++)
+        {
+            uint8_t parsed = parser.feed(bytes[n], now++);
+            bool last = n + 1 == bytes.size();
+            if (parsed == CONFIG_PARSE_FRAME && last && same(parser.frame(), frame))
+            {
+                frames++;
+            }
+            else if (parsed != CONFIG_PARSE_MORE && !(last && parsed == CONFIG_PARSE_FRAME))
+            {
+                mangled++;
+            }
+        }
+        recovered += frames;
+    }
+
+    printf("frames:         %u sent, %u recovered, %u mangled, %u of %u text bytes passed on\n", count, recovered,
+        mangled, text, sentText);
+    return recovered == count && mangled == 0 && text == sentText;
+}
+
+// One byte broken, then a pause like a host that times out and sends the
+// next frame. The broken one must not be taken, the next one must.
+static bool fuzzCorrupt(uint32_t count)
+{
+    ConfigParser parser;
+    uint32_t now = 0;
+    uint32_t accepted = 0;
+    uint32_t recovered = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ConfigFrame frame = randomFrame();
+        Bytes bytes = encode(frame);
+        bytes[random(bytes.size())] ^= 1 + random(255);
+        for (uint8_t c : bytes)
+        {
+            accepted += parser.feed(c, now++) == CONFIG_PARSE_FRAME;
+        }
+        now += CONFIG_FRAME_TIMEOUT + 1;
+
+        frame = randomFrame();
+        bytes = encode(frame);
+        for (uint8_t c : bytes)
+        {
+            recovered += parser.feed(c, now++) == CONFIG_PARSE_FRAME && same(parser.frame(), frame);
+        }
+    }
+
+    printf("corrupted:      %u sent, %u taken, %u good frames after them, %u errors, %u timeouts\n", count, accepted,
+        recovered, parser.errors, parser.timeouts);
+    return accepted == 0 && recovered == count;
+}
+
+// Frames longer than the parser takes, their payload full of what the text
+// handler acts on. None of it may reach the text handler, the error comes
+// with the last byte and the next frame is read as usual.
+static bool fuzzTooLong(uint32_t count)
+{
+    static const uint8_t text[] = { 'T', 'C', 'S', '0', ' ', '\n', '\r' };
+    ConfigParser parser;
+    uint32_t now = 0;
+    uint32_t leaked = 0;
+    uint32_t refused = 0;
+    uint32_t recovered = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t length = random(CONFIG_PAYLOAD_MAX + 1, 256);
+        Bytes bytes = { CONFIG_FRAME_MAGIC0, CONFIG_FRAME_MAGIC1, (uint8_t)random(256), (uint8_t)random(256), length };
+        for (int n = 0; n < length + 4; n++)
+        {
+            bytes.push_back(random(2) ? text[random(sizeof(text))] : random(256));
+        }
+        for (size_t n = 0; n < bytes.size(); n++)
+        {
+            uint8_t parsed = parser.feed(bytes[n], now++);
+            leaked += parsed == CONFIG_PARSE_TEXT;
+            refused += parsed == CONFIG_PARSE_ERROR && n + 1 == bytes.size() && parser.frame().length == length;
+        }
+
+        ConfigFrame frame = randomFrame();
+        for (uint8_t c : encode(frame))
+        {
+            recovered += parser.feed(c, now++) == CONFIG_PARSE_FRAME && same(parser.frame(), frame);
+        }
+    }
+
+    printf("too long:       %u sent, %u refused, %u good frames after them, %u bytes taken for text\n", count, refused,
+        recovered, leaked);
+    return leaked == 0 && refused == count && recovered == count;
+}
+
+// Anything at all, at any pace
+static bool fuzzNoise(uint32_t count)
+{
+    ConfigParser parser;
+    uint32_t now = 0;
+    uint32_t frames = 0;
+    uint32_t tooLong = 0;
+
+    for (uint32_t i = 0; i < count * 64; i++)
+    {
+        now += random(4) == 0 ? random(2 * CONFIG_FRAME_TIMEOUT) : 1;
+        uint8_t parsed = parser.feed(random(8) == 0 ? CONFIG_FRAME_MAGIC0 : random(256), now);
+        frames += parsed == CONFIG_PARSE_FRAME;
+        tooLong += parser.frame().length > CONFIG_PAYLOAD_MAX && parsed == CONFIG_PARSE_FRAME;
+    }
+
+    printf("noise:          %u bytes, %u frames taken, %u too long\n", count * 64, frames, tooLong);
+    return tooLong == 0;
+}
+
+// Random writes, imports and resets. The record must stay valid, read back
+// what was accepted and come back the same from NVS.
+static bool fuzzTunables(uint32_t count)
+{
+    Preferences preferences;
+    preferences.begin("fuzz");
+    preferences.remove("tunables");
+    Tunables tunables(preferences);
+    tunables.begin();
+
+    uint32_t accepted = 0;
+    uint32_t rejected = 0;
+    uint32_t invalid = 0;
+    uint32_t mismatches = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TunablesRecord before = tunables.get();
+        uint8_t action = random(16);
+        uint8_t status;
+        uint8_t id = 0;
+        uint8_t value[sizeof(TunablesRecord) + 1];
+        uint8_t length = 0;
+
+        if (action == 0)
+        {
+            status = tunables.reset();
+        }
+        else if (action < 3)
+        {
+            // The current record with a byte changed, the CRC mostly fixed
+            TunablesRecord next = before;
+            ((uint8_t *)&next)[random(offsetof(TunablesRecord, crc))] = random(256);
+            if (random(4) != 0)
+            {
+                next.crc = crc32((const uint8_t *)&next, offsetof(TunablesRecord, crc));
+            }
+            memcpy(value, &next, sizeof(next));
+            length = random(8) == 0 ? random(sizeof(value) + 1) : sizeof(next);
+            status = tunables.import(value, length);
+        }
+        else
+        {
+            // Mostly near the current value, so that some get through
+            id = random(NUM_TUNABLES + 1);
+            uint8_t size = 0;
+            if (tunables.read(id, value, size) != TUNABLES_OK)
+            {
+                size = random(8);
+            }
+            length = random(4) == 0 ? random(size + 2) : size;
+            for (uint8_t n = 0; n < length; n++)
+            {
+                if (n >= size || random(length) == 0)
+                {
+                    value[n] = random(4) == 0 ? random(256) : value[n] + random(5) - 2;
+                }
+            }
+            status = tunables.write(id, value, length);
+        }
+
+        bool ok = status == TUNABLES_OK || status == TUNABLES_OK_RESTART;
+        accepted += ok;
+        rejected += !ok;
+        invalid += !Tunables::valid(tunables.get());
+        if (!ok)
+        {
+            mismatches += memcmp(&before, &tunables.get(), sizeof(before)) != 0;
+        }
+        else if (id != 0)
+        {
+            uint8_t stored[sizeof(TunablesRecord)] = {};
+            uint8_t size = 0;
+            tunables.read(id, stored, size);
+            uint8_t expected[sizeof(TunablesRecord)] = {};
+            memcpy(expected, value, length);
+            mismatches += memcmp(stored, expected, size) != 0;
+        }
+
+        if (i % 64 == 0)
+        {
+            Tunables reloaded(preferences);
+            reloaded.begin();
+            mismatches += memcmp(&reloaded.get(), &tunables.get(), sizeof(TunablesRecord)) != 0;
+        }
+    }
+
+    printf("tunables:       %u changes, %u taken, %u refused, %u commits, %u mismatches\n", count, accepted, rejected,
+        tunables.commits, mismatches);
+    printf("invalid:        %u records\n", invalid);
+    return invalid == 0 && mismatches == 0 && accepted > 0 && rejected > 0;
+}
+
+int fuzz(uint32_t count)
+{
+    bool pass = fuzzFrames(count);
+    pass = fuzzCorrupt(count) && pass;
+    pass = fuzzTooLong(count) && pass;
+    pass = fuzzNoise(count) && pass;
+    pass = fuzzTunables(count) && pass;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
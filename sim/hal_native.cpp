@@ -0,0 +1,157 @@
+#include <chrono>
+#include "Arduino.h"
+#include "hal.h"
+#include "sim.h"
+
+void halSetBaseMac(const uint8_t *mac)
+{
+}
+
+uint32_t halRandomSeed()
+{
+    return sim.seed;
+}
+
+void halRestart()
+{
+    // The simulator reruns setup() once the current loop() returns
+    sim.restarts++;
+    sim.wakeCause = HAL_WAKE_RESET;
+    sim.restartRequested = true;
+}
+
+bool halWarmBoot()
+{
+    return sim.restarts > 0 || sim.deepSleeps > 0;
+}
+
+void halWait(uint32_t timeoutMs)
+{
+    if (sim.woken)
+    {
+        sim.woken = false;
+        return;
+    }
+
+    // Jump straight to the next timer or the next change the simulator makes
+    uint64_t until = sim.nextExternal;
+    if (timeoutMs != HAL_WAIT_FOREVER)
+    {
+        until = min(until, sim.elapsed + timeoutMs);
+    }
+
+    // Background tasks get to run on the way without waking loop()
+    while (sim.background)
+    {
+        uint64_t due = sim.background();
+        if (due >= until)
+        {
+            break;
+        }
+        sim.advance(due - sim.elapsed);
+    }
+
+    if (until > sim.elapsed)
+    {
+        sim.advance(until - sim.elapsed);
+    }
+}
+
+void halWake()
+{
+    sim.woken = true;
+}
+
+bool halStartUiTask(void (*task)(void))
+{
+    // Single threaded, loop() runs the UI itself
+    return false;
+}
+
+void halUiWait(uint32_t timeoutMs)
+{
+}
+
+void halUiWake()
+{
+    halWake();
+}
+
+void halSetCpuMhz(uint32_t mhz)
+{
+    sim.cpuMhz = mhz;
+}
+
+bool halEnableLightSleep(const uint8_t *wakePins, uint8_t count)
+{
+    return sim.lightSleep;
+}
+
+void halSetClock(uint32_t utc, int16_t offsetMinutes)
+{
+    sim.clockSet = true;
+    sim.clockBase = utc + offsetMinutes * 60;
+    sim.clockAt = sim.elapsed;
+}
+
+bool halLocalTime(uint32_t &local)
+{
+    return sim.localTime(local);
+}
+
+void halDeepSleep(uint32_t ms, uint8_t wakePin)
+{
+    sim.deepSleepMs = max(ms, (uint32_t)1);
+}
+
+HalWake halWakeCause()
+{
+    return (HalWake)sim.wakeCause;
+}
+
+bool halMemory(HalMemory &memory)
+{
+    return false;
+}
+
+uint32_t halStackFree(const char *taskName)
+{
+    return HAL_UNKNOWN;
+}
+
+// Partitions exist once written, erased flash reads as 0xFF
+bool halStorageErase(const char *partition, uint32_t size)
+{
+    std::vector<uint8_t> &data = sim.partitions[partition];
+    data.assign(max((size_t)size, data.size()), 0xFF);
+    return true;
+}
+
+bool halStorageWrite(const char *partition, uint32_t offset, const void *data, uint32_t size)
+{
+    std::vector<uint8_t> &stored = sim.partitions[partition];
+    if (offset + size > stored.size())
+    {
+        return false;
+    }
+    memcpy(stored.data() + offset, data, size);
+    sim.partitionWrites++;
+    return true;
+}
+
+bool halStorageRead(const char *partition, uint32_t offset, void *data, uint32_t size)
+{
+    auto found = sim.partitions.find(partition);
+    if (found == sim.partitions.end() || offset + size > found->second.size())
+    {
+        return false;
+    }
+    memcpy(data, found->second.data() + offset, size);
+    return true;
+}
+
+uint32_t halTimerUs()
+{
+    // Wall clock, the virtual clock does not move inside loop()
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
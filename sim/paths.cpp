@@ -0,0 +1,66 @@
+// Plans jiggles with random movement settings, run with --paths. Whatever
+// the tunables allow, every path has to bring the cursor and the wheel back
+// to where they started, fit the step buffer and keep the time of every
+// sample.
+
+#include <stdio.h>
+#include "jiggle.h"
+#include "tunables.h"
+
+// Any parameters Tunables::valid() accepts, the limits included
+static JiggleParams randomParams()
+{
+    JiggleParams params = {};
+    params.minDistance = random(1, JIGGLE_DISTANCE_LIMIT + 1);
+    params.maxDistance = random(params.minDistance, JIGGLE_DISTANCE_LIMIT + 1);
+    params.curve = random(101);
+    params.jitter = random(101);
+    params.wheelChance = random(101);
+    params.wheelMin = random(1, WHEEL_MAX_SCROLL + 1);
+    params.wheelMax = random(params.wheelMin, WHEEL_MAX_SCROLL + 1);
+    params.stepInterval = random(10, 1001);
+    params.wheelStepInterval = random(10, 2001);
+    params.wheelPeakPause = random(5001);
+    return params;
+}
+
+int paths(uint32_t count)
+{
+    JiggleStep steps[JIGGLE_MAX_STEPS];
+    TunablesRecord record;
+    Tunables::defaults(record);
+    uint32_t open = 0;
+    uint32_t invalid = 0;
+    uint32_t longest = 0;
+    uint32_t shortTimed = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // The defaults first, then anything
+        record.jiggle = i == 0 ? (JiggleParams)JIGGLE_PARAMS_DEFAULT : randomParams();
+        invalid += !Tunables::valid(record);
+
+        uint8_t n = Jiggle::plan(steps, record.jiggle);
+        int x = 0, y = 0, wheel = 0;
+        uint32_t moving = 0;
+        for (uint8_t j = 0; j < n; j++)
+        {
+            x += steps[j].x;
+            y += steps[j].y;
+            wheel += steps[j].wheel;
+            moving += steps[j].wheel == 0 ? steps[j].delay : 0;
+        }
+        open += x != 0 || y != 0 || wheel != 0;
+        // Out and back take every sample's interval, moving or not
+        shortTimed += moving != 2 * JIGGLE_PATH_STEPS * (uint32_t)record.jiggle.stepInterval;
+        longest = max(longest, (uint32_t)n);
+    }
+
+    bool pass = open == 0 && invalid == 0 && shortTimed == 0 && longest <= JIGGLE_MAX_STEPS;
+    printf("paths:          %u planned, %u did not return to start, longest %u of %d steps\n", count, open, longest,
+        JIGGLE_MAX_STEPS);
+    printf("timing:         %u paths not taking %d step intervals\n", shortTimed, 2 * JIGGLE_PATH_STEPS);
+    printf("parameters:     %u sets the tunables would refuse\n", invalid);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#include <string.h>
+#include "sim.h"
+
+Sim sim;
+
+Sim::Sim()
+{
+    // Buttons have pull-ups, released reads HIGH
+    memset(pins, 1, sizeof(pins));
+    memset(isr, 0, sizeof(isr));
+}
+
+void Sim::setPin(uint8_t pin, uint8_t level)
+{
+    if (pins[pin] != level)
+    {
+        pins[pin] = level;
+        if (isr[pin])
+        {
+            isr[pin]();
+        }
+    }
+}
+
+void Sim::advance(uint32_t ms)
+{
+    uint32_t before = now;
+    now += ms;
+    elapsed += ms;
+    if (now < before)
+    {
+        wraps++;
+    }
+}
+
+bool Sim::localTime(uint32_t &local) const
+{
+    local = clockBase + (elapsed - clockAt) / 1000;
+    return clockSet;
+}
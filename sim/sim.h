@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Same limit as the real BleMouse
+#define BLE_MAX_HOSTS 3
+
+// State of the simulated board, shared by the fake Arduino, BLE, display and
+// preferences implementations and driven by the simulator in main.cpp.
+struct SimReport {
+    uint32_t time;
+    uint32_t link;  // Connection the report was sent on
+    uint8_t host;   // Fake central that received it
+    uint16_t interval;  // Connection interval at the time, units of 1.25 ms
+    int16_t x;
+    int16_t y;
+    int16_t wheel;
+    uint32_t sinceSent;  // Time since the previous report went out to any host
+    uint32_t expected = 0;  // Jiggle interval it was sent under, 0 for the current one
+    uint64_t elapsed = 0;   // Simulation time it was sent at
+    int8_t tx = 0;          // TX power it went out at, dBm
+};
+
+// Fake centrals miss a notification that arrives weaker than this, give or
+// take a few dB of noise
+#define SIM_HOST_SENSITIVITY -90
+
+struct Sim {
+    uint32_t now = 0;           // Virtual millis(), wraps like the real one
+    uint64_t elapsed = 0;       // Virtual time since simulation start, never wraps
+    uint32_t wraps = 0;         // Number of millis() wraparounds seen
+    uint8_t pins[40];           // Input levels as seen by digitalRead()
+    void (*isr[40])(void);      // attachInterrupt() handlers, run on every level change
+    bool hostConnected[BLE_MAX_HOSTS] = {};
+    uint32_t hostLink[BLE_MAX_HOSTS] = {};  // Connection each host is on, numbered by links
+    int8_t hostRssi[BLE_MAX_HOSTS] = { -55, -55, -55 };  // What the board hears from each host, dBm, the path is symmetric
+    bool hostHiRes[BLE_MAX_HOSTS] = { true, true, true };  // Sets the wheel Resolution Multiplier on connect, like Windows
+    void (*connectionCallback)(void) = nullptr;
+    uint32_t links = 0;         // Number of times any host has connected
+    uint32_t restarts = 0;
+    bool restartRequested = false;
+    uint32_t seed = 1;
+    uint32_t cpuMhz = 240;
+    bool lightSleep = false;    // Pretend the build has automatic light sleep
+    bool woken = false;         // halWake() since the last halWait()
+    uint64_t nextExternal = 0;  // Elapsed time of the next change the simulator makes
+    uint64_t pixelsPushed = 0;  // Display pixels written over (virtual) SPI
+    uint8_t backlight = 0;      // PWM duty on the backlight pin
+    int ledcPin = -1;           // Pin the backlight channel drives, -1 while none does
+    uint32_t ledcDetached = 0;  // pinMode() took that pin back, later duty changes go nowhere
+    bool panelAsleep = false;   // ST7789 got SLPIN
+    uint64_t asleepPixels = 0;  // Pushed while it was asleep, lost on the real panel
+    uint32_t panelSleeps = 0;
+    bool framebuffer = false;   // Have the fake display and sprites really draw, only the render benchmark looks at pixels
+    uint64_t (*background)(void) = nullptr;  // Work outside loop(), runs what is due and returns when it is next due
+    std::vector<SimReport> reports;  // One per report and receiving host
+    std::vector<SimReport> lost;     // Reports a host never got, once the retries were given up
+    std::map<std::string, std::vector<uint8_t>> nvs;
+    uint32_t nvsWrites = 0;
+    std::map<std::string, std::vector<uint8_t>> partitions;  // Raw flash partitions by name
+    uint32_t partitionWrites = 0;
+    bool clockSet = false;      // halSetClock() was called
+    uint32_t clockBase = 0;     // Local time in seconds at elapsed clockAt
+    uint64_t clockAt = 0;
+    uint32_t deepSleepMs = 0;   // halDeepSleep() asked for this, the simulator sleeps once loop() returns
+    uint32_t deepSleeps = 0;
+    uint8_t wakeCause = 0;      // HalWake for the next setup()
+    bool traceNvs = false;      // Print every preference write, shows what button presses did
+
+    Sim();
+    void advance(uint32_t ms);
+    void setPin(uint8_t pin, uint8_t level);
+    bool localTime(uint32_t &local) const;
+};
+
+extern Sim sim;
@@ -0,0 +1,788 @@
+// Virtual-time simulator for [env:native]: runs the unmodified setup()/loop()
+// against the fakes in this directory and checks jiggle timing over a long
+// stretch of simulated operation, including the 49.7-day millis() wraparound.
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "Arduino.h"
+#include "config.h"
+#include "hal.h"
+#include "link.h"
+#include "power.h"
+#include "schedule.h"
+#include "scheduler.h"
+#include "tunables.h"
+#include <Preferences.h>
+
+void setup();
+void loop();
+int bench(uint32_t count, const char *budgets, bool json);
+int stress(uint32_t count);
+int fuzz(uint32_t count);
+int paths(uint32_t count);
+extern BleMouse bleMouse;
+extern LinkControl linkControl;
+
+extern int jiggle_interval;
+extern Scheduler scheduler;
+extern Power power;
+extern Schedule schedule;
+extern Tunables tunables;
+
+struct Options {
+    double days = 60;
+    uint32_t start = 0;                     // Initial millis(), set close to 2^32 to hit the wrap early
+    uint32_t connectAt = 3000;              // When the first fake host connects
+    uint8_t hosts = 1;                      // Fake centrals, each one connects a second after the previous
+    int lowResHost = -1;                    // This host never sets the wheel Resolution Multiplier
+    uint32_t dropEvery = 0;                 // Each host drops the link this often, 0 never, staggered between hosts
+    uint32_t dropFor = 10000;               // and stays away this long
+    uint32_t seed = 1;
+    const char *edges = nullptr;            // Recorded button edges to replay
+    bool energy = false;                    // Estimate energy per day for every interval
+    uint32_t bench = 0;                     // Run the micro-benchmarks this many times instead
+    const char *budgets = nullptr;          // Benchmark limits replacing the defaults in bench.cpp
+    bool json = false;                      // Benchmark results as JSON lines
+    uint32_t stress = 0;                    // Run the threaded primitives this many times instead
+    const char *capture = nullptr;          // Serial output to this file, ending with a trace dump
+    const char *replay = nullptr;           // Check a recorded trace exported by tools/trace.py instead
+    uint32_t clock = 0;                     // Set the firmware clock to this, UTC seconds, right after boot
+    int fade = 0;                           // Each host's signal fades by up to this many dB and back
+    uint32_t fuzz = 0;                      // Fuzz the config protocol this many times instead
+    uint32_t paths = 0;                     // Check this many jiggle paths with random settings instead
+    const char *input = nullptr;            // Raw bytes to send to serial right after boot, e.g. from tools/config.py
+};
+
+// Hosts are heard at SIM_NEAR_RSSI, a fade takes this long and the hosts
+// are spread over it
+#define SIM_NEAR_RSSI -55
+#define SIM_FADE_PERIOD 1800000
+
+// One line of an edge file: "<ms since start> <pin> <level>"
+struct Edge {
+    uint64_t time;
+    uint8_t pin;
+    uint8_t level;
+};
+
+struct Result {
+    uint32_t jiggles = 0;
+    uint32_t minGap = UINT32_MAX;
+    uint32_t maxGap = 0;
+    uint64_t sumGap = 0;
+    uint32_t timedGaps = 0;
+    uint32_t badGaps = 0;
+    uint32_t badDisplacements = 0;
+    uint32_t slowReports = 0;
+    uint32_t offHoursJiggles = 0;  // Started outside the active windows
+    uint32_t lateWindows = 0;      // Opened without a jiggle within the interval + variance
+    uint32_t windows = 0;          // Openings checked
+    uint32_t badSleeps = 0;        // Deep sleeps that began in a window or ran into one
+};
+
+// One deep sleep of the firmware
+struct Sleep {
+    uint64_t start;  // Elapsed
+    uint32_t ms;
+};
+
+static void usage(const char *name)
+{
+    printf("usage: %s [--days N] [--start MS] [--seed N] [--drop-every MS] [--hosts N] [--lowres-host N] [--edges FILE] [--energy] [--light-sleep] [--bench N] [--budgets FILE] [--json] [--stress N] [--capture FILE] [--replay FILE] [--clock UTC] [--fade DB] [--fuzz N] [--paths N] [--input FILE] [--verbose]\n", name);
+    exit(2);
+}
+
+static Options parse(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--verbose") == 0)
+        {
+            Serial.echo = true;
+            continue;
+        }
+        if (strcmp(arg, "--energy") == 0)
+        {
+            options.energy = true;
+            continue;
+        }
+        if (strcmp(arg, "--light-sleep") == 0)
+        {
+            sim.lightSleep = true;
+            continue;
+        }
+        if (strcmp(arg, "--json") == 0)
+        {
+            options.json = true;
+            continue;
+        }
+        if (!value)
+        {
+            usage(argv[0]);
+        }
+
+        if (strcmp(arg, "--days") == 0)
+            options.days = atof(value);
+        else if (strcmp(arg, "--start") == 0)
+            options.start = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--drop-every") == 0)
+            options.dropEvery = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--hosts") == 0)
+            options.hosts = constrain(atoi(value), 1, BLE_MAX_HOSTS);
+        else if (strcmp(arg, "--lowres-host") == 0)
+            options.lowResHost = constrain(atoi(value), 0, BLE_MAX_HOSTS - 1);
+        else if (strcmp(arg, "--stress") == 0)
+            options.stress = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--bench") == 0)
+            options.bench = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--budgets") == 0)
+            options.budgets = value;
+        else if (strcmp(arg, "--edges") == 0)
+            options.edges = value;
+        else if (strcmp(arg, "--capture") == 0)
+            options.capture = value;
+        else if (strcmp(arg, "--replay") == 0)
+            options.replay = value;
+        else if (strcmp(arg, "--clock") == 0)
+            options.clock = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--fade") == 0)
+            options.fade = constrain(atoi(value), 0, 60);
+        else if (strcmp(arg, "--fuzz") == 0)
+            options.fuzz = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--paths") == 0)
+            options.paths = strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--input") == 0)
+            options.input = value;
+        else
+            usage(argv[0]);
+        i++;
+    }
+
+    return options;
+}
+
+// Reports closer together than this belong to the same jiggle
+#define BURST_GAP 5000
+
+static uint32_t variance = JIGGLE_TIME_VARIANCE;  // Of the run, or from the replayed trace
+
+static void closeBurst(Result &result, int sumX, int sumY, int sumWheel)
+{
+    if (sumX != 0 || sumY != 0 || sumWheel != 0)
+    {
+        result.badDisplacements++;
+    }
+}
+
+static std::vector<Edge> loadEdges(const char *path)
+{
+    std::vector<Edge> edges;
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        exit(2);
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned long long time;
+        unsigned pin, level;
+        if (line[0] == '#' || sscanf(line, "%llu %u %u", &time, &pin, &level) != 3)
+        {
+            continue;
+        }
+        edges.push_back({ time, (uint8_t)pin, (uint8_t)(level ? HIGH : LOW) });
+    }
+
+    fclose(file);
+    return edges;
+}
+
+// Trace exported by tools/trace.py --export, one record per line:
+// "<ms> report <buttons> <x> <y> <wheel> <hwheel>", "<ms> state <hosts>
+// <running> <interval s>", "<ms> boot" or "<ms> truncated" (the jiggle that
+// follows may be missing its beginning). The reports go into sim.reports as
+// if one host had received them. Every state record and boot starts a new
+// link, gaps and displacement are only checked within one.
+static uint32_t loadReplay(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        exit(2);
+    }
+
+    char line[128];
+    char kind[16];
+    uint32_t records = 0;
+    uint32_t link = 1;
+    uint32_t expected = 0;
+    uint32_t lastSent = 0;
+    bool sent = false;
+    bool truncated = false;
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned long time;
+        int a, b, c, d, e;
+        unsigned long header;
+        if (sscanf(line, "# variance %lu", &header) == 1)
+        {
+            variance = header;
+            continue;
+        }
+        if (line[0] == '#' || sscanf(line, "%lu %15s", &time, kind) != 2)
+        {
+            continue;
+        }
+        records++;
+
+        if (strcmp(kind, "report") == 0 && sscanf(line, "%*u %*s %d %d %d %d %d", &a, &b, &c, &d, &e) == 5)
+        {
+            // Like a host that connected mid-jiggle
+            uint32_t sinceSent = truncated ? 0 : sent ? time - lastSent : UINT32_MAX;
+            truncated = false;
+            sim.reports.push_back({ (uint32_t)time, link, 0, 0, (int16_t)b, (int16_t)c, (int16_t)d, sinceSent, expected });
+            lastSent = time;
+            sent = true;
+        }
+        else if (strcmp(kind, "state") == 0 && sscanf(line, "%*u %*s %d %d %d", &a, &b, &c) == 3)
+        {
+            expected = c * 1000;
+            link++;
+        }
+        else if (strcmp(kind, "truncated") == 0)
+        {
+            truncated = true;
+        }
+        else if (strcmp(kind, "boot") == 0)
+        {
+            sent = false;
+            link++;
+        }
+        else
+        {
+            fprintf(stderr, "%s: cannot read %s", path, line);
+        }
+    }
+
+    fclose(file);
+    return records;
+}
+
+// Host link schedule: host n connects n seconds after connectAt, then
+// optionally drops for dropFor once every dropEvery period. The drops are
+// spread over the period so the hosts come and go independently.
+static uint64_t hostPhase(const Options &options, uint8_t host, uint64_t t)
+{
+    uint64_t offset = (uint64_t)options.dropEvery * host / options.hosts;
+    return (t - options.connectAt - host * 1000 + options.dropEvery - offset) % options.dropEvery;
+}
+
+static bool hostUp(const Options &options, uint8_t host, uint64_t t)
+{
+    if (t < options.connectAt + host * 1000)
+    {
+        return false;
+    }
+    return options.dropEvery == 0 || hostPhase(options, host, t) >= options.dropFor;
+}
+
+static uint64_t hostNextChange(const Options &options, uint8_t host, uint64_t t)
+{
+    if (t < options.connectAt + host * 1000)
+    {
+        return options.connectAt + host * 1000;
+    }
+    if (options.dropEvery == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t phase = hostPhase(options, host, t);
+    return t - phase + (phase < options.dropFor ? options.dropFor : options.dropEvery);
+}
+
+static int8_t hostRssi(const Options &options, uint8_t host, uint64_t t)
+{
+    double phase = 2 * M_PI * (t + (uint64_t)SIM_FADE_PERIOD * host / options.hosts) / SIM_FADE_PERIOD;
+    return lround(SIM_NEAR_RSSI - options.fade * (1 - cos(phase)) / 2);
+}
+
+static void analyzeHost(Result &result, uint8_t host)
+{
+    int sumX = 0, sumY = 0, sumWheel = 0;
+    bool first = true;
+    uint32_t burstStart = 0;
+    uint32_t burstLink = 0;  // 0 for a jiggle the host only saw the end of
+    uint32_t lastReport = 0;
+    size_t next = 0;
+    size_t nextLost = 0;
+
+    // Gap between two jiggles is the interval minus the random variance
+
+    for (;;)
+    {
+        // The reports the host got and the ones it lost in time order, a
+        // lost one counts as if it had arrived: the jiggle must still add
+        // up to zero with it
+        while (next < sim.reports.size() && sim.reports[next].host != host)
+        {
+            next++;
+        }
+        while (nextLost < sim.lost.size() && sim.lost[nextLost].host != host)
+        {
+            nextLost++;
+        }
+        bool lost = nextLost < sim.lost.size() &&
+            (next == sim.reports.size() || sim.lost[nextLost].time <= sim.reports[next].time);
+        if (!lost && next == sim.reports.size())
+        {
+            break;
+        }
+        const SimReport &report = lost ? sim.lost[nextLost++] : sim.reports[next++];
+
+        if (first || report.time - lastReport > BURST_GAP)
+        {
+            if (!first)
+            {
+                // A jiggle cut short by a dropped link cannot return to start
+                if (report.link == burstLink)
+                {
+                    closeBurst(result, sumX, sumY, sumWheel);
+                }
+
+                // A reconnect catches up on an overdue jiggle, only time
+                // gaps within one connection
+                uint32_t gap = report.time - burstStart;
+                uint32_t interval = report.expected ? report.expected : jiggle_interval;
+                uint32_t low = interval - variance;
+                uint32_t high = interval + variance;
+                if (report.link == burstLink)
+                {
+                    result.minGap = min(result.minGap, gap);
+                    result.maxGap = max(result.maxGap, gap);
+                    result.sumGap += gap;
+                    result.timedGaps++;
+                    if (gap < low || gap > high)
+                    {
+                        result.badGaps++;
+                    }
+                }
+            }
+
+            // A host that connects while the others are mid-jiggle only
+            // gets the rest of it
+            first = false;
+            burstStart = report.time;
+            burstLink = report.sinceSent > BURST_GAP ? report.link : 0;
+            sumX = sumY = sumWheel = 0;
+        }
+
+        // Sent before the fast connection profile took effect
+        if (!lost && report.interval > BLE_FAST_INTERVAL_MAX)
+        {
+            result.slowReports++;
+        }
+
+        sumX += report.x;
+        sumY += report.y;
+        sumWheel += report.wheel;
+        lastReport = report.time;
+    }
+
+    if (burstLink != 0)
+    {
+        closeBurst(result, sumX, sumY, sumWheel);
+    }
+}
+
+static Result analyze(const Options &options)
+{
+    Result result;
+
+    for (size_t i = 0; i < sim.reports.size(); i++)
+    {
+        // First copy of the first report of a jiggle
+        const SimReport &report = sim.reports[i];
+        if (report.sinceSent > BURST_GAP && (i == 0 || sim.reports[i - 1].time != report.time))
+        {
+            result.jiggles++;
+        }
+    }
+
+    for (uint8_t host = 0; host < options.hosts; host++)
+    {
+        analyzeHost(result, host);
+    }
+
+    return result;
+}
+
+static std::vector<Edge> edges;
+static size_t nextEdge = 0;
+static std::vector<Sleep> sleeps;
+
+// Local clock seconds at an elapsed time, the sim clock runs with offset 0
+static uint32_t localAt(uint64_t elapsed)
+{
+    return sim.clockBase + (elapsed - sim.clockAt) / 1000;
+}
+
+// Checks the jiggles and deep sleeps against the active windows. Every
+// jiggle has to start inside one, every sleep has to begin outside and end
+// before the next one opens, and a window that stays open for a whole
+// interval + variance has to see a jiggle in that time.
+static void checkSchedule(const Options &options, Result &result)
+{
+    std::vector<uint64_t> starts;  // Elapsed time of every jiggle
+    for (size_t i = 0; i < sim.reports.size(); i++)
+    {
+        const SimReport &report = sim.reports[i];
+        if (report.sinceSent > BURST_GAP && (i == 0 || sim.reports[i - 1].time != report.time))
+        {
+            starts.push_back(report.elapsed);
+            if (report.elapsed >= sim.clockAt && !schedule.active(localAt(report.elapsed)))
+            {
+                result.offHoursJiggles++;
+            }
+        }
+    }
+
+    for (const Sleep &sleep : sleeps)
+    {
+        uint32_t local = localAt(sleep.start);
+        if (schedule.active(local) || sleep.ms / 1000 >= schedule.untilChange(local))
+        {
+            result.badSleeps++;
+        }
+    }
+
+    // A dropped link or a button press can hold up the first jiggle for good reasons
+    if (options.dropEvery || options.edges)
+    {
+        return;
+    }
+    uint32_t late = (jiggle_interval + variance + BLE_SETTLE_DELAY) / 1000;
+    uint32_t local = localAt(sim.clockAt);
+    uint32_t end = localAt(sim.elapsed);
+    while (true)
+    {
+        uint32_t until = schedule.untilChange(local);
+        if (until == SCHEDULE_NEVER || local + until >= end)
+        {
+            break;
+        }
+        local += until;
+        uint32_t open = schedule.untilChange(local);
+        if (!schedule.active(local) || open <= late || local + late >= end)
+        {
+            continue;
+        }
+
+        result.windows++;
+        uint64_t opened = sim.clockAt + (uint64_t)(local - sim.clockBase) * 1000;
+        auto first = std::lower_bound(starts.begin(), starts.end(), opened);
+        if (first == starts.end() || *first > opened + late * 1000)
+        {
+            result.lateWindows++;
+        }
+    }
+}
+
+// Runs loop() until the given elapsed time, returns the number of wakeups
+static uint64_t run(const Options &options, uint64_t until)
+{
+    uint64_t loops = 0;
+
+    while (sim.elapsed < until)
+    {
+        // loop() sleeps in halWait(), which returns at the next timer or at
+        // the next host link change, whichever comes first
+        sim.nextExternal = until;
+        for (uint8_t host = 0; host < options.hosts; host++)
+        {
+            bool connect = hostUp(options, host, sim.elapsed);
+            if (connect != sim.hostConnected[host])
+            {
+                if (connect)
+                {
+                    sim.hostLink[host] = ++sim.links;
+                }
+                sim.hostConnected[host] = connect;
+                if (sim.connectionCallback)
+                {
+                    sim.connectionCallback();
+                }
+            }
+            sim.nextExternal = min(sim.nextExternal, hostNextChange(options, host, sim.elapsed));
+            sim.hostRssi[host] = hostRssi(options, host, sim.elapsed);
+        }
+
+        // Button edges run the firmware's pin interrupt like the real thing
+        while (nextEdge < edges.size() && edges[nextEdge].time <= sim.elapsed)
+        {
+            sim.setPin(edges[nextEdge].pin, edges[nextEdge].level);
+            nextEdge++;
+        }
+        if (nextEdge < edges.size())
+        {
+            sim.nextExternal = min(sim.nextExternal, edges[nextEdge].time);
+        }
+
+        loop();
+        loops++;
+
+        if (sim.restartRequested)
+        {
+            sim.restartRequested = false;
+            setup();
+        }
+
+        // The radio is off, hosts see the link time out. Nothing runs until
+        // the timer fires, then the firmware boots again.
+        if (sim.deepSleepMs)
+        {
+            sleeps.push_back({ sim.elapsed, sim.deepSleepMs });
+            for (uint8_t host = 0; host < options.hosts; host++)
+            {
+                sim.hostConnected[host] = false;
+            }
+            sim.advance(sim.deepSleepMs);
+            sim.deepSleepMs = 0;
+            sim.deepSleeps++;
+            sim.wakeCause = HAL_WAKE_TIMER;
+            setup();
+        }
+    }
+
+    return loops;
+}
+
+// Boots once per entry of INTERVAL_LIST and reports the energy estimate
+static int energy(const Options &options, uint64_t duration)
+{
+    int intervals[] = INTERVAL_LIST;
+    Preferences preferences;
+
+    printf("%s, %.1f days per interval\n", sim.lightSleep ? "light sleep" : "reduced clock", options.days);
+    printf("interval  jiggles  wakeups/s  active s/day  mAh/day\n");
+
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++)
+    {
+        // Boots through the legacy key migration with the interval to test
+        preferences.begin("app");
+        preferences.remove("settings");
+        preferences.putShort("intv", i);
+        sim.reports.clear();
+
+        setup();
+        uint32_t wakeups = scheduler.wakeups;
+        uint64_t start = sim.elapsed;
+        run(options, start + duration);
+
+        Result result = analyze(options);
+        double days = duration / 86400000.0;
+        printf("%6d s  %7u  %9.3f  %12.1f  %7.0f\n", intervals[i], result.jiggles,
+            (scheduler.wakeups - wakeups) / (duration / 1000.0),
+            power.stateTime(POWER_ACTIVE, millis()) / 1e6 / days, power.mAhPerDay(millis()));
+    }
+
+    return 0;
+}
+
+// Sends a file to serial as it is, frames and all
+static void feedInput(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        perror(path);
+        exit(2);
+    }
+    uint8_t buffer[256];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        Serial.feed(buffer, length);
+    }
+    fclose(file);
+}
+
+// Runs the jiggle checks of a normal run over a recorded trace
+static int replay(const Options &options)
+{
+    uint32_t records = loadReplay(options.replay);
+    Result result = analyze(options);
+    // A trace of a paused jiggler has nothing to check, that is not a failure
+    bool pass = result.badGaps == 0 && result.badDisplacements == 0;
+
+    printf("records:        %u, %zu of them reports\n", records, sim.reports.size());
+    printf("jiggles:        %u\n", result.jiggles);
+    if (result.timedGaps > 0)
+    {
+        printf("jiggle gap:     min %.1f s, avg %.1f s, max %.1f s, %u outside the interval +/- %.0f s\n",
+            result.minGap / 1000.0, result.sumGap / 1000.0 / result.timedGaps, result.maxGap / 1000.0, result.badGaps,
+            variance / 1000.0);
+    }
+    printf("displacement:   %u jiggles did not return to start\n", result.badDisplacements);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parse(argc, argv);
+    uint64_t duration = (uint64_t)(options.days * 24 * 3600 * 1000);
+
+    sim.now = options.start;
+    sim.seed = options.seed;
+    if (options.lowResHost >= 0)
+    {
+        sim.hostHiRes[options.lowResHost] = false;
+    }
+
+    if (options.edges)
+    {
+        edges = loadEdges(options.edges);
+        sim.traceNvs = true;
+    }
+
+    if (options.stress)
+    {
+        return stress(options.stress);
+    }
+
+    if (options.fuzz)
+    {
+        randomSeed(options.seed);
+        return fuzz(options.fuzz);
+    }
+
+    if (options.paths)
+    {
+        randomSeed(options.seed);
+        return paths(options.paths);
+    }
+
+    if (options.bench)
+    {
+        randomSeed(options.seed);
+        return bench(options.bench, options.budgets, options.json);
+    }
+
+    if (options.energy)
+    {
+        return energy(options, duration);
+    }
+
+    if (options.replay)
+    {
+        return replay(options);
+    }
+
+    if (options.capture)
+    {
+        Serial.capture = fopen(options.capture, "wb");
+        if (!Serial.capture)
+        {
+            perror(options.capture);
+            return 2;
+        }
+    }
+
+    clock_t started = clock();
+
+    setup();
+    if (options.clock)
+    {
+        // Like tools/clock.py right after boot
+        char command[32];
+        snprintf(command, sizeof(command), "%c%u 0\n", SCHEDULE_CLOCK_COMMAND, options.clock);
+        Serial.feed(command);
+    }
+    if (options.input)
+    {
+        feedInput(options.input);
+    }
+    uint64_t loops = run(options, duration);
+    double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+    if (Serial.capture)
+    {
+        // Ask for the trace like the host tool would
+        const char command[] = { TRACE_DUMP_COMMAND, '\0' };
+        Serial.feed(command);
+        loop();
+        fclose(Serial.capture);
+    }
+    variance = tunables.get().timeVariance;
+    Result result = analyze(options);
+    if (sim.clockSet)
+    {
+        checkSchedule(options, result);
+    }
+    // Replayed button presses may pause the jiggler, then no jiggles are fine
+    bool pass = (result.timedGaps > 0 || options.edges) && result.badGaps == 0 && result.badDisplacements == 0 &&
+        sim.restarts == 0 && result.offHoursJiggles == 0 && result.lateWindows == 0 && result.badSleeps == 0 &&
+        sim.asleepPixels == 0 && sim.ledcDetached == 0;
+
+    printf("simulated:      %.1f days in %.2f s (%llu loops)\n", options.days, seconds, (unsigned long long)loops);
+    printf("wakeups:        %.3f/s\n", scheduler.wakeups / (duration / 1000.0));
+    printf("millis wraps:   %u\n", sim.wraps);
+    printf("restarts:       %u\n", sim.restarts);
+    printf("jiggles:        %u at %d s interval\n", result.jiggles, jiggle_interval / 1000);
+    printf("connections:    %u from %u hosts\n", sim.links, options.hosts);
+    if (result.timedGaps > 0)
+    {
+        printf("jiggle gap:     min %.1f s, avg %.1f s, max %.1f s, %u out of range\n",
+            result.minGap / 1000.0, result.sumGap / 1000.0 / result.timedGaps, result.maxGap / 1000.0, result.badGaps);
+    }
+    printf("displacement:   %u jiggles did not return to start\n", result.badDisplacements);
+    printf("reports:        %zu delivered, %u on a slow connection interval\n", sim.reports.size(), result.slowReports);
+    int64_t tx = 0;
+    for (const SimReport &report : sim.reports)
+    {
+        tx += report.tx;
+    }
+    printf("link:           %.1f dBm average TX, %u failed, %u retried, %u lost, %u raises, %u lowers\n",
+        sim.reports.empty() ? 0.0 : (double)tx / sim.reports.size(), bleMouse.reportsFailed, bleMouse.reportsRetried,
+        bleMouse.reportsLost, linkControl.raises, linkControl.lowers);
+    printf("pixels pushed:  %llu, %llu of them while the panel slept (%u sleeps)\n", (unsigned long long)sim.pixelsPushed,
+        (unsigned long long)sim.asleepPixels, sim.panelSleeps);
+    printf("backlight:      taken off LEDC %u times\n", sim.ledcDetached);
+    printf("nvs writes:     %u\n", sim.nvsWrites);
+    if (sim.clockSet)
+    {
+        uint64_t slept = 0;
+        for (const Sleep &sleep : sleeps)
+        {
+            slept += sleep.ms;
+        }
+        printf("deep sleeps:    %u, %.1f h of %.1f h, %u ending inside or started in a window\n", sim.deepSleeps,
+            slept / 3.6e6, sim.elapsed / 3.6e6, result.badSleeps);
+        printf("windows:        %u opened, %u without a jiggle in time, %u jiggles outside\n", result.windows,
+            result.lateWindows, result.offHoursJiggles);
+        float awake = power.mAhPerDayAwake(millis());
+        float scheduled = power.mAhPerDay(millis());
+        printf("energy:         ~%.0f mAh/day, ~%.0f without the schedule (%.0f%% saved)\n", scheduled, awake,
+            awake > 0 ? 100 * (1 - scheduled / awake) : 0);
+    }
+    else
+    {
+        printf("energy:         ~%.0f mAh/day\n", power.mAhPerDay(millis()));
+    }
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// Runs the engine/UI primitives under real threads, run with --stress. The
+// rest of the simulator is single threaded and cannot catch a torn snapshot
+// or a lost command.
+
+#include <stdio.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "seqlock.h"
+#include "spsc.h"
+
+// Every field derived from one counter, a mix of fields from two writes
+// shows up as a mismatch
+struct Sample {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+};
+
+static bool consistent(const Sample &sample)
+{
+    return sample.b == sample.a * 3 && sample.c == ~sample.a && sample.d == sample.a + 7;
+}
+
+#define SEQLOCK_READERS 3
+
+static bool stressSeqlock(uint32_t writes)
+{
+    Seqlock<Sample> lock;
+    bool done = false;
+    uint32_t ready = 0;
+    uint32_t written = 0;
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    uint64_t reads = 0;
+    uint64_t fewest = UINT64_MAX;
+
+    // Readers first, counting only reads that saw a write, and they also
+    // check that values never go back in time
+    std::vector<std::thread> readers;
+    std::vector<uint32_t> tornPerReader(SEQLOCK_READERS), backwardsPerReader(SEQLOCK_READERS);
+    std::vector<uint64_t> readsPerReader(SEQLOCK_READERS);
+    for (int r = 0; r < SEQLOCK_READERS; r++)
+    {
+        readers.emplace_back([&, r] {
+            uint32_t last = 0;
+            Sample sample;
+            __atomic_add_fetch(&ready, 1, __ATOMIC_RELEASE);
+            while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE))
+            {
+                lock.read(sample);
+                if (sample.a == 0 && sample.b == 0)
+                {
+                    continue;  // Nothing written yet
+                }
+                __atomic_store_n(&readsPerReader[r], readsPerReader[r] + 1, __ATOMIC_RELAXED);
+                tornPerReader[r] += !consistent(sample);
+                backwardsPerReader[r] += sample.a < last;
+                last = sample.a;
+            }
+        });
+    }
+
+    // The writer waits for every reader, then keeps going until each one
+    // has read as often as it was asked to write
+    std::thread writer([&] {
+        while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < SEQLOCK_READERS)
+        {
+            std::this_thread::yield();
+        }
+        uint32_t i = 1;
+        for (;; i++)
+        {
+            lock.write({ i, i * 3, ~i, i + 7 });
+            if (i < writes || i % 64 != 0)
+            {
+                continue;
+            }
+            bool enough = true;
+            for (int r = 0; r < SEQLOCK_READERS; r++)
+            {
+                enough = enough && __atomic_load_n(&readsPerReader[r], __ATOMIC_RELAXED) >= writes;
+            }
+            if (enough)
+            {
+                break;
+            }
+        }
+        written = i;
+        __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    });
+
+    writer.join();
+    for (int r = 0; r < SEQLOCK_READERS; r++)
+    {
+        readers[r].join();
+        torn += tornPerReader[r];
+        backwards += backwardsPerReader[r];
+        reads += readsPerReader[r];
+        fewest = std::min(fewest, readsPerReader[r]);
+    }
+
+    printf("seqlock:        %u writes, %llu reads, %llu by the slowest reader, %u torn, %u out of order\n",
+        written, (unsigned long long)reads, (unsigned long long)fewest, torn, backwards);
+    return torn == 0 && backwards == 0 && fewest >= writes && fewest > 0;
+}
+
+static bool stressQueue(uint32_t count)
+{
+    SpscQueue<uint32_t, 8> queue;
+    uint32_t lost = 0;
+    uint32_t received = 0;
+
+    // The producer retries when full, so every value must arrive in order
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= count; i++)
+        {
+            while (!queue.push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&] {
+        uint32_t expected = 1;
+        uint32_t value;
+        while (expected <= count)
+        {
+            if (!queue.pop(value))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            lost += value != expected;
+            expected = value + 1;
+            received++;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    printf("spsc queue:     %u pushed, %u received, %u out of sequence\n", count, received, lost);
+    return lost == 0 && received == count;
+}
+
+int stress(uint32_t count)
+{
+    bool pass = stressSeqlock(count);
+    pass = stressQueue(count) && pass;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "TFT_eSPI.h"
+
+// Only the sleep commands matter here
+void TFT_eSPI::writecommand(uint8_t c)
+{
+    if (c == TFT_SLPIN && !sim.panelAsleep)
+    {
+        sim.panelSleeps++;
+    }
+    if (c == TFT_SLPIN || c == TFT_SLPOUT)
+    {
+        sim.panelAsleep = c == TFT_SLPIN;
+    }
+}
+
+void TFT_eSPI::drawn(uint32_t count)
+{
+    sim.pixelsPushed += count;
+    sim.asleepPixels += sim.panelAsleep ? count : 0;
+}
+
+void TFT_eSPI::setRotation(uint8_t r)
+{
+    if ((r & 1) != (_width > _height))
+    {
+        // Contents do not survive a rotation on the panel either
+        std::swap(_width, _height);
+        pixels.assign((size_t)_width * _height, 0);
+    }
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color)
+{
+    int32_t x0 = max(x, (int32_t)0), x1 = min(x + w, (int32_t)_width);
+    int32_t y0 = max(y, (int32_t)0), y1 = min(y + h, (int32_t)_height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    for (int32_t row = y0; row < y1 && sim.framebuffer; row++)
+    {
+        std::fill_n(&pixels[(size_t)row * _width + x0], x1 - x0, color);
+    }
+    drawn((uint32_t)(x1 - x0) * (y1 - y0));
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color)
+{
+    fillRect(x, y, w, 1, color);
+    fillRect(x, y + h - 1, w, 1, color);
+    fillRect(x, y + 1, 1, h - 2, color);
+    fillRect(x + w - 1, y + 1, 1, h - 2, color);
+}
+
+size_t TFT_eSPI::print(const char *text)
+{
+    // GLCD font cells are 6x8 pixels, scaled by the text size. The glyphs are
+    // made up from the character code: same amount of work as the real font,
+    // different characters give different pixels.
+    size_t len = strlen(text);
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = text[i];
+        for (uint8_t column = 0; column < 5 && c != ' '; column++)
+        {
+            uint8_t bits = ((c * 0x9D + column * 0x3B) | 0x41) & 0x7F;
+            if (!sim.framebuffer)
+            {
+                // Same count without touching pixels
+                drawn(__builtin_popcount(bits) * textSize * textSize);
+                continue;
+            }
+            for (uint8_t row = 0; row < 7; row++)
+            {
+                if (bits & (1 << row))
+                {
+                    fillRect(cursorX + column * textSize, cursorY + row * textSize, textSize, textSize, textColor);
+                }
+            }
+        }
+        cursorX += 6 * textSize;
+    }
+    return len;
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+    int32_t x0 = max(x, (int32_t)0), x1 = min(x + w, (int32_t)_width);
+    int32_t y0 = max(y, (int32_t)0), y1 = min(y + h, (int32_t)_height);
+    drawn((uint32_t)w * h);
+
+    for (int32_t row = y0; row < y1 && sim.framebuffer; row++)
+    {
+        for (int32_t column = x0; column < x1; column++)
+        {
+            uint16_t pixel = data[(size_t)(row - y) * w + column - x];
+            pixels[(size_t)row * _width + column] = (pixel >> 8) | (pixel << 8);
+        }
+    }
+}
+
+bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh)
+{
+    sw = min(sw, (int32_t)_width - sx);
+    sh = min(sh, (int32_t)_height - sy);
+    parent->drawn((uint32_t)max(sw, (int32_t)0) * max(sh, (int32_t)0));
+
+    // Clip to the panel, row by row copies from there
+    int32_t x0 = max(tx, (int32_t)0), x1 = min(tx + sw, (int32_t)parent->_width);
+    int32_t y0 = max(ty, (int32_t)0), y1 = min(ty + sh, (int32_t)parent->_height);
+    for (int32_t y = y0; y < y1 && sim.framebuffer; y++)
+    {
+        const uint16_t *from = &pixels[(size_t)(sy + y - ty) * _width + sx + x0 - tx];
+        std::copy_n(from, max(x1 - x0, (int32_t)0), &parent->pixels[(size_t)y * parent->_width + x0]);
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#include "config.h"
+
+#if UI_DISPLAY
+
+#include <Arduino.h>
+#include "backlight.h"
+
+static const char *stateNames[NUM_DISPLAY_STATES] = { "on", "dim", "off" };
+
+void Backlight::begin(uint32_t now)
+{
+    ledcSetup(DISPLAY_PWM_CHANNEL, DISPLAY_PWM_FREQ, 8);
+    ledcAttachPin(TFT_BL, DISPLAY_PWM_CHANNEL);
+
+    state = DISPLAY_ON;
+    lastActivity = now;
+    since = now;
+    fadeFrom = target = DISPLAY_BRIGHTNESS;
+    write(DISPLAY_BRIGHTNESS);
+}
+
+bool Backlight::activity(uint32_t now)
+{
+    lastActivity = now;
+    bool woke = asleep;
+
+    if (asleep)
+    {
+        // The panel keeps its memory through sleep but shows stale content,
+        // the backlight stays off until it has been redrawn
+        display.writecommand(TFT_SLPOUT);
+        asleep = false;
+        waking = true;
+        wakeAt = now + DISPLAY_WAKE_TIME;
+    }
+    if (state != DISPLAY_ON)
+    {
+        enter(DISPLAY_ON, DISPLAY_BRIGHTNESS, now);
+    }
+    return woke;
+}
+
+bool Backlight::update(uint32_t now)
+{
+    account(now);
+    hasNext = false;
+
+    if (waking)
+    {
+        if ((int32_t)(now - wakeAt) < 0)
+        {
+            nextAt = wakeAt;
+            hasNext = true;
+            return false;
+        }
+        waking = false;
+        redraw = true;
+        fadeAt = now;  // Fade in from here, after the redraw
+    }
+    if (asleep)
+    {
+        return false;
+    }
+
+    uint32_t idle = now - lastActivity;
+    if (state == DISPLAY_ON && DISPLAY_DIM_AFTER > 0 && idle >= DISPLAY_DIM_AFTER)
+    {
+        enter(DISPLAY_DIM, DISPLAY_DIM_BRIGHTNESS, now);
+    }
+    if (state != DISPLAY_OFF && DISPLAY_OFF_AFTER > 0 && idle >= DISPLAY_OFF_AFTER)
+    {
+        enter(DISPLAY_OFF, 0, now);
+    }
+
+    if (duty != target)
+    {
+        uint32_t t = now - fadeAt;
+        write(t >= DISPLAY_FADE_TIME ? target : fadeFrom + ((int)target - fadeFrom) * (int)t / DISPLAY_FADE_TIME);
+    }
+
+    if (duty != target)
+    {
+        nextAt = now + DISPLAY_FADE_FRAME;
+        hasNext = true;
+    }
+    else if (state == DISPLAY_OFF)
+    {
+        // Dark, the panel can sleep until a button wakes it
+        display.writecommand(TFT_SLPIN);
+        asleep = true;
+        return false;
+    }
+    else if (state == DISPLAY_ON && DISPLAY_DIM_AFTER > 0)
+    {
+        nextAt = lastActivity + DISPLAY_DIM_AFTER;
+        hasNext = true;
+    }
+    else if (DISPLAY_OFF_AFTER > 0)
+    {
+        nextAt = lastActivity + DISPLAY_OFF_AFTER;
+        hasNext = true;
+    }
+    return true;
+}
+
+bool Backlight::deadline(uint32_t &when) const
+{
+    when = nextAt;
+    return hasNext;
+}
+
+bool Backlight::takeRedraw()
+{
+    bool taken = redraw;
+    redraw = false;
+    return taken;
+}
+
+void Backlight::enter(uint8_t next, uint8_t brightness, uint32_t now)
+{
+    account(now);
+    state = next;
+    fadeFrom = duty;
+    target = brightness;
+    fadeAt = now;
+}
+
+void Backlight::account(uint32_t now)
+{
+    // Whole seconds only, the rest is counted with the next state
+    uint32_t whole = (now - since) / 1000;
+    __atomic_store_n(&seconds[state], seconds[state] + whole, __ATOMIC_RELAXED);
+    since += whole * 1000;
+}
+
+void Backlight::write(uint8_t value)
+{
+    duty = value;
+    ledcWrite(DISPLAY_PWM_CHANNEL, value);
+}
+
+float Backlight::stateMa(uint8_t state)
+{
+    switch (state)
+    {
+    case DISPLAY_ON:
+        return POWER_PANEL_MA + POWER_BACKLIGHT_MA * DISPLAY_BRIGHTNESS / 255;
+    case DISPLAY_DIM:
+        return POWER_PANEL_MA + POWER_BACKLIGHT_MA * DISPLAY_DIM_BRIGHTNESS / 255;
+    default:
+        return POWER_PANEL_SLEEP_MA;
+    }
+}
+
+float Backlight::averageMa() const
+{
+    uint32_t total = 0;
+    float mAs = 0;
+    for (uint8_t i = 0; i < NUM_DISPLAY_STATES; i++)
+    {
+        uint32_t s = stateSeconds(i);
+        total += s;
+        mAs += s * stateMa(i);
+    }
+    return total > 0 ? mAs / total : stateMa(DISPLAY_ON);
+}
+
+void Backlight::report() const
+{
+    Serial.printf("display:");
+    for (uint8_t i = 0; i < NUM_DISPLAY_STATES; i++)
+    {
+        Serial.printf(" %s %u s (%.2f mA)", stateNames[i], stateSeconds(i), stateMa(i));
+    }
+    Serial.printf(", ~%.1f mA average\n", averageMa());
+}
+
+#endif
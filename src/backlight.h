@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <TFT_eSPI.h>
+
+enum DisplayState {
+    DISPLAY_ON,   // Full brightness
+    DISPLAY_DIM,  // Still readable, DISPLAY_DIM_BRIGHTNESS
+    DISPLAY_OFF,  // Backlight off, panel in sleep mode, nothing is drawn
+    NUM_DISPLAY_STATES
+};
+
+// Backlight brightness over LEDC PWM and the panel's sleep mode. Dims
+// DISPLAY_DIM_AFTER after the last button edge and turns off
+// DISPLAY_OFF_AFTER after it, fading in between. Off, the ST7789 gets SLPIN
+// and rendering stops until a button wakes it. Owned by the display task,
+// only the state times are read from elsewhere.
+class Backlight
+{
+public:
+    Backlight(TFT_eSPI &display) : display(display) {}
+
+    void begin(uint32_t now);
+
+    // A button edge, true when it woke the panel from sleep
+    bool activity(uint32_t now);
+
+    // Runs the fades and timeouts. False while the panel sleeps or wakes,
+    // nothing may be drawn then.
+    bool update(uint32_t now);
+    bool deadline(uint32_t &when) const;  // Next time update() has to run
+
+    // Set once the panel is back from sleep, the caller redraws everything
+    bool takeRedraw();
+
+    uint32_t stateSeconds(uint8_t state) const { return __atomic_load_n(&seconds[state], __ATOMIC_RELAXED); }
+    float averageMa() const;  // Panel and backlight, over the time counted
+    void report() const;
+
+    static float stateMa(uint8_t state);
+
+private:
+    TFT_eSPI &display;
+    uint8_t state = DISPLAY_ON;
+    uint32_t lastActivity = 0;
+    uint8_t duty = 0;       // What the PWM is set to
+    uint8_t fadeFrom = 0;
+    uint8_t target = 0;
+    uint32_t fadeAt = 0;    // millis() the fade to target began
+    bool asleep = false;    // SLPIN sent
+    uint32_t wakeAt = 0;    // SLPOUT sent, the panel takes commands again at this time
+    bool waking = false;
+    bool redraw = false;
+    uint32_t nextAt = 0;
+    bool hasNext = false;
+    uint32_t since = 0;     // Start of the time not counted yet
+    uint32_t seconds[NUM_DISPLAY_STATES] = {};
+
+    void enter(uint8_t next, uint8_t brightness, uint32_t now);
+    void account(uint32_t now);
+    void write(uint8_t value);
+};
@@ -0,0 +1,38 @@
+#include <Arduino.h>
+#include "boot.h"
+
+static const char *const phaseNames[NUM_BOOT_PHASES] = {
+    "settings", "ble", "setup", "display", "screen", "connected", "report"
+};
+
+void BootTimer::begin(uint32_t now)
+{
+    started = now;
+    done = 0;
+}
+
+void BootTimer::mark(uint8_t phase, uint32_t now)
+{
+    if (reached(phase))
+    {
+        return;
+    }
+
+    // Time first, readers go by the bit
+    at[phase] = now - started;
+    __atomic_fetch_or(&done, 1u << phase, __ATOMIC_RELEASE);
+}
+
+void BootTimer::report() const
+{
+    // Milliseconds since setup() began, phases the build does not have are left out
+    Serial.printf("boot: setup began %u ms after reset", started);
+    for (uint8_t phase = 0; phase < NUM_BOOT_PHASES; phase++)
+    {
+        if (reached(phase))
+        {
+            Serial.printf(", %s %u", phaseNames[phase], at[phase]);
+        }
+    }
+    Serial.println(" ms");
+}
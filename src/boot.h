@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Milestones from reset to the first mouse report, in the order they are
+// expected. The display ones happen on the UI task, next to the BLE start.
+enum BootPhase {
+    BOOT_SETTINGS,   // Preferences read
+    BOOT_BLE,        // BLE stack up and advertising
+    BOOT_SETUP,      // setup() returned
+    BOOT_DISPLAY,    // Panel initialized
+    BOOT_SCREEN,     // Status screen up, after the boot animation if there is one
+    BOOT_CONNECTED,  // First host connected
+    BOOT_REPORT,     // First HID report queued
+    NUM_BOOT_PHASES
+};
+
+// Timestamps each phase the first time it is reached, from any task, and
+// logs them all as one line
+class BootTimer
+{
+public:
+    void begin(uint32_t now);
+    void mark(uint8_t phase, uint32_t now);
+    bool reached(uint8_t phase) const { return __atomic_load_n(&done, __ATOMIC_ACQUIRE) & (1u << phase); }
+    void report() const;
+
+private:
+    uint32_t started = 0;  // millis() when setup() began, the ESP32 counts from reset
+    uint32_t at[NUM_BOOT_PHASES] = {};
+    uint32_t done = 0;     // Bit per phase reached
+};
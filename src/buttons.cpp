@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include "buttons.h"
+
+void Button::begin(uint8_t level)
+{
+    stable = candidate = level;
+    init = level == HIGH;
+}
+
+void Button::edge(uint32_t time, uint8_t level)
+{
+    // Bounces restart the settle time, a repeated level changes nothing
+    if (level != candidate)
+    {
+        candidate = level;
+        candidateAt = time;
+    }
+}
+
+short Button::settled(uint32_t time)
+{
+    stable = candidate;
+
+    if (!init)
+    {
+        // First released state registered, a press before that is ignored
+        init = stable == HIGH;
+        return BUTTON_NONE;
+    }
+
+    if (stable == LOW && !pressed && !lockout)
+    {
+        pressed = true;
+        longpress = false;
+        pressedAt = time;
+    }
+    else if (stable == HIGH && pressed)
+    {
+        pressed = false;
+        lockout = true;
+        releasedAt = time;
+        if (!longpress)
+        {
+            // No longpress recorded, so it's a short press
+            return BUTTON_PRESS;
+        }
+    }
+
+    return BUTTON_NONE;
+}
+
+short Button::update(uint32_t now)
+{
+    if (candidate != stable && now - candidateAt >= BUTTON_SETTLE)
+    {
+        short result = settled(candidateAt);
+        if (result != BUTTON_NONE)
+        {
+            return result;
+        }
+    }
+
+    if (pressed && !longpress && now - pressedAt > LONG_PRESS)
+    {
+        longpress = true;
+        return BUTTON_LONGPRESS;
+    }
+
+    if (lockout && now - releasedAt > DEBOUNCE_DELAY)
+    {
+        // Debounce time expired, a button still held counts as pressed from now
+        lockout = false;
+        if (stable == LOW && init)
+        {
+            pressed = true;
+            longpress = false;
+            pressedAt = now;
+        }
+    }
+
+    return BUTTON_NONE;
+}
+
+static void earliest(bool &found, uint32_t &when, uint32_t candidate)
+{
+    if (!found || (int32_t)(candidate - when) < 0)
+    {
+        when = candidate;
+    }
+    found = true;
+}
+
+bool Button::deadline(uint32_t &when) const
+{
+    bool found = false;
+
+    if (candidate != stable)
+    {
+        earliest(found, when, candidateAt + BUTTON_SETTLE);
+    }
+    if (pressed && !longpress)
+    {
+        earliest(found, when, pressedAt + LONG_PRESS + 1);
+    }
+    if (lockout)
+    {
+        earliest(found, when, releasedAt + DEBOUNCE_DELAY + 1);
+    }
+
+    return found;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+#include "spsc.h"
+
+// Types
+#define BUTTON_NONE 0
+#define BUTTON_PRESS 1
+#define BUTTON_LONGPRESS 2
+
+// Level change seen by a pin interrupt
+struct ButtonEdge {
+    uint32_t time;
+    uint8_t button;
+    uint8_t level;
+};
+
+#define BUTTON_QUEUE_SIZE 16  // Power of two
+
+// Pin interrupts to the UI task. On overflow the consumer re-reads the pins.
+typedef SpscQueue<ButtonEdge, BUTTON_QUEUE_SIZE> ButtonQueue;
+
+// Turns raw, bouncing edges into BUTTON_PRESS/BUTTON_LONGPRESS. A level counts
+// once it has been stable for BUTTON_SETTLE, a press is reported on release,
+// a long press once held for LONG_PRESS, and after a release the button is
+// ignored for DEBOUNCE_DELAY.
+class Button
+{
+public:
+    void begin(uint8_t level);
+    void edge(uint32_t time, uint8_t level);
+    short update(uint32_t now);
+
+    // When update() needs to run next without a new edge, false if never
+    bool deadline(uint32_t &when) const;
+
+private:
+    bool init = false;        // Released once since boot, a button held at boot is ignored
+    uint8_t stable = 1;       // Debounced level, HIGH is released
+    uint8_t candidate = 1;    // Last raw level
+    uint32_t candidateAt = 0;
+    bool pressed = false;
+    bool longpress = false;
+    bool lockout = false;
+    uint32_t pressedAt = 0;
+    uint32_t releasedAt = 0;
+
+    short settled(uint32_t time);
+};
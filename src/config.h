@@ -0,0 +1,151 @@
+#pragma once
+
+// Bluetooth Configs
+#define JIGGLE_STEP_INTERVAL 50      // Time per path sample (milliseconds)
+#define JIGGLE_MIN_DISTANCE 1        // Smaller movements (1-5 pixels)
+#define JIGGLE_MAX_DISTANCE 5
+#define JIGGLE_PATH_STEPS 12         // Samples per leg, out and back each follow a minimum-jerk curve
+#define JIGGLE_CURVE 40              // Curve bend, up to this percentage of the distance to either side
+#define JIGGLE_JITTER 20             // Chance (%) of a 1 pixel tremor at each sample along the way
+#define JIGGLE_TIME_VARIANCE 20000   // +/- 20 seconds random timing variance (in milliseconds)
+#define WHEEL_SCROLL_CHANCE 50      // 50% chance to include wheel scroll
+#define WHEEL_MIN_SCROLL 1          // Minimum scroll amount
+#define WHEEL_MAX_SCROLL 3          // Maximum scroll amount
+#define WHEEL_STEP_INTERVAL 200     // Slower scroll speed (200ms between notches)
+#define WHEEL_PEAK_PAUSE 300        // Longer pause at scroll peak
+#define INTERVAL_LIST { 60, 90, 180, 300, 600, 900 }
+#define DEFAULT_INTERVAL 2
+#define INTERVAL_MAX_COUNT 8         // Intervals the tunables can hold
+#define INTERVAL_MIN 10              // Range an interval set at runtime must be in (seconds)
+#define INTERVAL_MAX 3600
+
+// Identity the jiggler shows hosts, defaults of the tunables
+#define BLE_DEVICE_NAME "Logitech M510"
+#define BLE_MANUFACTURER "Logitech"
+#define BLE_NAME_MAX 25
+#define BLE_MAC_BASE { 0x00, 0x1F, 0x20, 0x37, 0xAE, 0xCB }  // Logitech Inc. OUI, byte 4 gets 0x10 added with MOUSE_HIRES
+
+// Connection parameter profiles: interval in units of 1.25 ms, latency in
+// connection events the mouse may skip, supervision timeout in units of 10 ms
+#define BLE_IDLE_INTERVAL_MIN 72     // 90 ms
+#define BLE_IDLE_INTERVAL_MAX 96     // 120 ms
+#define BLE_IDLE_LATENCY 10          // Radio wakes at most every 1.3 s while idle
+#define BLE_FAST_INTERVAL_MIN 6      // 7.5 ms
+#define BLE_FAST_INTERVAL_MAX 12     // 15 ms
+#define BLE_FAST_LATENCY 0
+#define BLE_TIMEOUT 600              // 6 s
+#define BLE_FAST_LEAD 2000           // Switch to the fast profile this long before a jiggle (milliseconds)
+#define BLE_SETTLE_DELAY 5000        // Leave the central's parameters alone after connecting (milliseconds)
+
+// Link Control: TX power per host follows the RSSI it is heard at, see link.h
+#define LINK_RSSI_INTERVAL 30000     // RSSI sample while connected (milliseconds)
+#define LINK_TARGET_RSSI -80         // What the host should receive (dBm), about 10 dB over typical sensitivity
+#define LINK_HOST_TX 0               // Assumed host TX power (dBm), turns our RSSI into path loss
+#define LINK_FAIL_MARGIN 6           // Extra dB after a sample with failed notifications
+#define LINK_MARGIN_MAX 12           // decaying by 1 dB per good sample
+#define LINK_HYSTERESIS 3            // Lower the power only with this many dB to spare
+#define LINK_WEAK_RSSI -85           // Warn on serial and show the link in red below this (dBm)
+
+// 16-bit report map with a high-resolution wheel instead of the 5-byte one
+// every host understands. The jiggler shows up under its own MAC address
+// with it, hosts pair again when this changes.
+#ifndef MOUSE_HIRES
+#define MOUSE_HIRES 0
+#endif
+
+// Build Profiles, selected with -DUI_PROFILE=... in build_flags, see platformio.ini
+#define UI_HEADLESS 0                 // No display, status on serial only
+#define UI_MINIMAL 1                  // Status, countdown and footer, no animations
+#define UI_FULL 2
+#ifndef UI_PROFILE
+#define UI_PROFILE UI_FULL
+#endif
+#define UI_DISPLAY (UI_PROFILE != UI_HEADLESS)  // TFT_eSPI and the renderer are compiled in
+
+// Display Configs
+#define DISPLAY_UPDATE_INTERVAL 1000  // Display refresh rate (milliseconds)
+#define RENDER_STATS 0                // Log pixels/bytes pushed per frame to serial
+#define BOOT_SPLASH_TIME 2000         // Boot animation after power-on, 0 for none (milliseconds)
+#define BOOT_SPLASH_FRAME 200         // Boot animation frame time (milliseconds)
+#define DISPLAY_DIM_AFTER 30000       // Dim this long after the last button edge, 0 never (milliseconds)
+#define DISPLAY_OFF_AFTER 120000      // Backlight off and panel asleep this long after it, 0 never (milliseconds)
+#define DISPLAY_BRIGHTNESS 255        // Backlight PWM duty, out of 255
+#define DISPLAY_DIM_BRIGHTNESS 24
+#define DISPLAY_FADE_TIME 400         // Between brightness levels (milliseconds)
+#define DISPLAY_FADE_FRAME 20         // Backlight step during a fade (milliseconds)
+#define DISPLAY_WAKE_TIME 5           // ST7789 takes no commands this long after SLPOUT (milliseconds)
+#define DISPLAY_PWM_CHANNEL 0         // LEDC channel driving TFT_BL
+#define DISPLAY_PWM_FREQ 5000         // Hz, well above visible flicker
+
+// Button Configs
+#define BUTTON_UP 0
+#define BUTTON_DOWN 35
+#define DEBOUNCE_DELAY 250
+#define LONG_PRESS 1000
+#define BUTTON_SETTLE 20              // A level must be stable this long to count (milliseconds)
+
+// Power Configs
+#define POWER_SAVE 1                  // Lower clock or light sleep between jiggles
+#define POWER_ACTIVE_MHZ 240
+#define POWER_IDLE_MHZ 80             // Lowest clock the BLE controller allows
+// Estimated supply current per state (mA) for the energy report. Rough
+// datasheet figures, measure your board for real numbers.
+#define POWER_ACTIVE_MA 68.0          // 240 MHz, radio active
+#define POWER_IDLE_MA 22.0            // 80 MHz, BLE modem sleep between connection events
+#define POWER_SLEEP_MA 4.0            // Automatic light sleep, woken for connection events
+#define POWER_PANEL_MA 3.0            // ST7789 awake, backlight off
+#define POWER_BACKLIGHT_MA 19.0       // Backlight at full duty, scales with DISPLAY_BRIGHTNESS
+#define POWER_PANEL_SLEEP_MA 0.05     // Panel in sleep mode, backlight off
+#define POWER_DEEP_SLEEP_MA 0.35      // Deep sleep outside the active windows, board regulator and USB bridge included
+#define POWER_WAKEUP_US 300           // CPU time per loop() wakeup
+#define POWER_SPI_BYTES_PER_US 5      // 40 MHz SPI clock
+
+// Settings Configs
+#define SETTINGS_COMMIT_DELAY 5000    // Write settings to flash once left alone this long (milliseconds)
+
+// Scheduler Configs
+#define STATS_INTERVAL 60000          // Log loop() wakeups to serial this often (milliseconds)
+
+// Active Windows
+// Jiggle only inside these, in local time, and deep sleep outside them once
+// the host has set the clock (see tools/clock.py). Days are a mask of
+// SCHEDULE_MONDAY... from schedule.h, times are minutes since midnight and a
+// window whose end is not after its start runs past midnight.
+#define SCHEDULE_ENABLED 1
+#define SCHEDULE_LIST { { SCHEDULE_WEEKDAYS, 8 * 60, 18 * 60 } }
+#define SCHEDULE_WAKE_LEAD 60         // Wake this long before a window opens, so hosts reconnect in time (seconds)
+#define SCHEDULE_MIN_SLEEP 300        // Stay awake through shorter breaks between windows (seconds)
+#define SCHEDULE_WAKE_HOLD 600        // Stay awake after a button press outside the windows (seconds)
+#define SCHEDULE_CHECK_INTERVAL 3600  // Look at the clock at least this often (seconds)
+#define SCHEDULE_CLOCK_COMMAND 'C'    // Serial line "C<UTC seconds> <offset minutes>" sets the clock
+
+// Config Protocol, see protocol.h and tools/config.py
+#define CONFIG_FRAME_TIMEOUT 500      // Drop a frame that stops arriving for this long (milliseconds)
+
+// HID Trace
+#define TRACE_BUFFER_SIZE 4096        // Recorded reports, 3-5 bytes each (bytes)
+#define TRACE_QUEUE_SIZE 64           // Sent reports on their way from the report task to loop(), power of two
+#define TRACE_DUMP_COMMAND 'T'        // Serial byte that has the trace written out
+// Keep the trace in the "trace" flash partition across restarts. Needs a
+// partition table that has one, see [env:hiletgo-esp32-lcd-trace].
+#ifndef TRACE_PERSIST
+#define TRACE_PERSIST 0
+#endif
+#define TRACE_SAVE_INTERVAL 3600000   // Write the trace to flash at most this often (milliseconds)
+
+// Memory Configs
+#define UI_TASK_STACK 4096            // Display task, statically allocated (bytes)
+
+// Latency Probes
+// Set with -DPROBES=1 in build_flags rather than here, so BleMouse times its
+// notifications too. Off, the probes compile to nothing.
+#ifndef PROBES
+#define PROBES 0
+#endif
+#define PROBE_SLOW_US 5000            // Keep a record of every probe that took at least this long
+#define PROBE_SLOW_EVENTS 16          // Slow records kept between telemetry frames
+
+// Backlight pin for TTGO T-Display
+#ifndef TFT_BL
+#define TFT_BL 4
+#endif
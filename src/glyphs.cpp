@@ -0,0 +1,88 @@
+#include "config.h"
+
+#if UI_DISPLAY
+
+#include "glyphs.h"
+
+void GlyphAtlas::begin(TFT_eSPI &display)
+{
+    // Print each character into a cell sized sprite and read it back
+    TFT_eSprite cell(&display);
+    cell.setColorDepth(16);
+    cell.createSprite(GLYPH_WIDTH, GLYPH_HEIGHT);
+    cell.setTextSize(1);
+    cell.setTextColor(TFT_WHITE);
+
+    for (char c = GLYPH_FIRST; c <= GLYPH_LAST; c++)
+    {
+        cell.fillSprite(TFT_BLACK);
+        cell.setCursor(0, 0);
+        cell.print(c);
+
+        uint8_t *bits = columns[c - GLYPH_FIRST];
+        for (uint8_t x = 0; x < GLYPH_WIDTH; x++)
+        {
+            bits[x] = 0;
+            for (uint8_t y = 0; y < GLYPH_HEIGHT; y++)
+            {
+                bits[x] |= (cell.readPixel(x, y) != TFT_BLACK) << y;
+            }
+        }
+    }
+
+    cell.deleteSprite();
+}
+
+// Size as a constant lets the compiler unroll the scaling
+template <uint8_t SIZE>
+static void expandScaled(const uint8_t *bits, uint16_t color, uint16_t background, uint16_t *pixels)
+{
+    const uint16_t width = GLYPH_WIDTH * SIZE;
+    for (uint8_t y = 0; y < GLYPH_HEIGHT; y++)
+    {
+        uint16_t *row = pixels + y * SIZE * width;
+        for (uint8_t x = 0; x < GLYPH_WIDTH; x++)
+        {
+            uint16_t pixel = (bits[x] >> y) & 1 ? color : background;
+            for (uint8_t i = 0; i < SIZE; i++)
+            {
+                row[x * SIZE + i] = pixel;
+            }
+        }
+
+        // The other rows of a scaled font row are the same
+        for (uint8_t i = 1; i < SIZE; i++)
+        {
+            memcpy(row + i * width, row, width * sizeof(uint16_t));
+        }
+    }
+}
+
+void GlyphAtlas::expand(char c, uint8_t size, uint16_t color, uint16_t background, uint16_t *pixels) const
+{
+    if (c < GLYPH_FIRST || c > GLYPH_LAST)
+    {
+        c = '?';
+    }
+
+    // pushImage() sends the buffer as it is in memory, the panel wants the
+    // high byte first
+    color = (color >> 8) | (color << 8);
+    background = (background >> 8) | (background << 8);
+
+    const uint8_t *bits = columns[c - GLYPH_FIRST];
+    switch (size)
+    {
+    case 1:
+        expandScaled<1>(bits, color, background, pixels);
+        break;
+    case 2:
+        expandScaled<2>(bits, color, background, pixels);
+        break;
+    default:
+        expandScaled<GLYPH_MAX_SIZE>(bits, color, background, pixels);
+        break;
+    }
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <TFT_eSPI.h>
+
+// GLCD font cell, 5x7 glyph plus a column and a row of spacing
+#define GLYPH_WIDTH 6
+#define GLYPH_HEIGHT 8
+#define GLYPH_FIRST ' '
+#define GLYPH_LAST '~'
+#define GLYPH_MAX_SIZE 3  // Largest text size drawn from the atlas
+
+// Every printable character of the built-in font as a bitmap, rasterised once
+// at boot. A cell is expanded into 16-bit pixels in any color and size and
+// goes to the panel with one pushImage(), instead of the scaled per-pixel
+// rectangles the font is otherwise drawn with.
+class GlyphAtlas
+{
+public:
+    void begin(TFT_eSPI &display);
+
+    // Fills pixels with the cell of c, GLYPH_WIDTH * size by
+    // GLYPH_HEIGHT * size, byte swapped for pushImage()
+    void expand(char c, uint8_t size, uint16_t color, uint16_t background, uint16_t *pixels) const;
+
+private:
+    uint8_t columns[GLYPH_LAST - GLYPH_FIRST + 1][GLYPH_WIDTH];  // Bit per row, top row in bit 0
+};
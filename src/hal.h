@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Platform calls outside the Arduino API. The ESP32 build implements them in
+// hal_esp32.cpp, the [env:native] simulator in sim/hal_native.cpp.
+
+void halSetBaseMac(const uint8_t *mac);
+uint32_t halRandomSeed();
+void halRestart();
+
+// True when the last reset was not a power-on, after a crash or a restart
+bool halWarmBoot();
+
+// Sleep until timeoutMs passed or halWake() was called, a wake that came in
+// before the wait returns immediately
+#define HAL_WAIT_FOREVER UINT32_MAX
+void halWait(uint32_t timeoutMs);
+void halWake();
+
+// Display task on the core loop() does not run on, calls task over and over.
+// Returns false where there is only one thread, the caller then runs the UI
+// from loop(). halUiWait()/halUiWake() work like halWait()/halWake().
+bool halStartUiTask(void (*task)(void));
+void halUiWait(uint32_t timeoutMs);
+void halUiWake();
+
+// Power management. Light sleep also needs the BLE controller to keep time
+// in sleep, returns false where that is not available.
+void halSetCpuMhz(uint32_t mhz);
+bool halEnableLightSleep(const uint8_t *wakePins, uint8_t count);
+
+// Wall clock, set from the host. The RTC keeps it through deep sleep and
+// restarts, not through a power cycle. halLocalTime() is seconds since 1970
+// in local time, false until the clock has been set.
+void halSetClock(uint32_t utc, int16_t offsetMinutes);
+bool halLocalTime(uint32_t &local);
+
+// Deep sleep until ms passed or wakePin goes low, the chip then boots from
+// scratch and only RTC_DATA_ATTR variables keep their values. The backlight
+// pin is held low meanwhile. Does not return on the ESP32, the simulator
+// returns and reruns setup() once loop() is done.
+enum HalWake {
+    HAL_WAKE_RESET,   // Power-on, restart or crash
+    HAL_WAKE_TIMER,
+    HAL_WAKE_BUTTON
+};
+void halDeepSleep(uint32_t ms, uint8_t wakePin);
+// Also lets go of the backlight pin, call it before the display comes up
+HalWake halWakeCause();
+
+// Heap state and the least stack space a task ever had left, in bytes.
+// halMemory() returns false and halStackFree() HAL_UNKNOWN where there is
+// nothing to measure.
+#define HAL_UNKNOWN UINT32_MAX
+struct HalMemory {
+    uint32_t heapFree;
+    uint32_t heapMinFree;  // Lowest since boot
+    uint32_t heapLargest;  // Largest block malloc() could still hand out
+};
+bool halMemory(HalMemory &memory);
+uint32_t halStackFree(const char *taskName);
+
+// Raw flash partition by name, for data that has to survive a restart but is
+// too big for preferences. Erase before writing, erasing rounds up to whole
+// sectors. All return false where there is no such partition.
+bool halStorageErase(const char *partition, uint32_t size);
+bool halStorageWrite(const char *partition, uint32_t offset, const void *data, uint32_t size);
+bool halStorageRead(const char *partition, uint32_t offset, void *data, uint32_t size);
+
+// Microsecond timer for timing short stretches of code. Runs at a fixed
+// rate whatever the CPU clock does, wraps after 71 minutes, only
+// differences mean anything.
+uint32_t halTimerUs();
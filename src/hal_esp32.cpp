@@ -0,0 +1,247 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_bt.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+#include "config.h"
+#include "hal.h"
+
+void halSetBaseMac(const uint8_t *mac)
+{
+    esp_base_mac_addr_set(mac);
+}
+
+uint32_t halRandomSeed()
+{
+    return esp_random();
+}
+
+void halRestart()
+{
+    ESP.restart();
+}
+
+bool halWarmBoot()
+{
+    return esp_reset_reason() != ESP_RST_POWERON;
+}
+
+static TaskHandle_t waitingTask = NULL;
+static TaskHandle_t uiTask = NULL;
+static StaticTask_t uiTaskBuffer;
+static StackType_t uiStack[UI_TASK_STACK];
+
+static void IRAM_ATTR notify(TaskHandle_t task)
+{
+    if (task == NULL)
+    {
+        return;
+    }
+
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task, &woken);
+        if (woken)
+        {
+            portYIELD_FROM_ISR();
+        }
+    }
+    else
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void take(uint32_t timeoutMs)
+{
+    ulTaskNotifyTake(pdTRUE, timeoutMs == HAL_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+}
+
+void halWait(uint32_t timeoutMs)
+{
+    waitingTask = xTaskGetCurrentTaskHandle();
+    take(timeoutMs);
+}
+
+void IRAM_ATTR halWake()
+{
+    notify(waitingTask);
+}
+
+static void uiLoop(void *parameter)
+{
+    void (*task)(void) = (void (*)(void))parameter;
+    for (;;)
+    {
+        task();
+    }
+}
+
+bool halStartUiTask(void (*task)(void))
+{
+#if CONFIG_FREERTOS_UNICORE
+    return false;
+#else
+    // Below the BLE host tasks, which share that core
+    int core = 1 - xPortGetCoreID();
+    uiTask = xTaskCreateStaticPinnedToCore(uiLoop, "ui", UI_TASK_STACK, (void *)task, 1, uiStack, &uiTaskBuffer, core);
+    return uiTask != NULL;
+#endif
+}
+
+void halUiWait(uint32_t timeoutMs)
+{
+    take(timeoutMs);
+}
+
+void IRAM_ATTR halUiWake()
+{
+    notify(uiTask);
+}
+
+void halSetCpuMhz(uint32_t mhz)
+{
+    if (getCpuFrequencyMhz() != mhz)
+    {
+        setCpuFrequencyMhz(mhz);
+    }
+}
+
+bool halEnableLightSleep(const uint8_t *wakePins, uint8_t count)
+{
+    // The prebuilt Arduino core ships without power management and tickless
+    // idle, a custom sdkconfig is needed for automatic light sleep. BLE also
+    // needs the 32 kHz crystal as sleep clock, otherwise the controller holds
+    // the CPU awake and only modem sleep takes effect.
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = 240;
+    config.min_freq_mhz = 80;
+    config.light_sleep_enable = true;
+    if (esp_pm_configure(&config) != ESP_OK)
+    {
+        return false;
+    }
+
+    // Buttons are pulled up, pressed reads low
+    for (uint8_t i = 0; i < count; i++)
+    {
+        gpio_wakeup_enable((gpio_num_t)wakePins[i], GPIO_INTR_LOW_LEVEL);
+    }
+    esp_sleep_enable_gpio_wakeup();
+    esp_bt_sleep_enable();
+    return true;
+#else
+    return false;
+#endif
+}
+
+// RTC memory survives deep sleep and restarts, the magic tells a set clock
+// from power-on garbage
+#define CLOCK_MAGIC 0x636C6F6B
+static RTC_DATA_ATTR uint32_t clockMagic;
+static RTC_DATA_ATTR int32_t clockOffset;  // Seconds
+
+void halSetClock(uint32_t utc, int16_t offsetMinutes)
+{
+    timeval time = { (time_t)utc, 0 };
+    settimeofday(&time, NULL);
+    clockOffset = offsetMinutes * 60;
+    clockMagic = CLOCK_MAGIC;
+}
+
+bool halLocalTime(uint32_t &local)
+{
+    if (clockMagic != CLOCK_MAGIC)
+    {
+        return false;
+    }
+
+    timeval time;
+    gettimeofday(&time, NULL);
+    local = time.tv_sec + clockOffset;
+    return true;
+}
+
+void halDeepSleep(uint32_t ms, uint8_t wakePin)
+{
+    // A floating backlight pin leaves the panel glowing
+    rtc_gpio_init((gpio_num_t)TFT_BL);
+    rtc_gpio_set_direction((gpio_num_t)TFT_BL, RTC_GPIO_MODE_OUTPUT_ONLY);
+    rtc_gpio_set_level((gpio_num_t)TFT_BL, 0);
+    rtc_gpio_hold_en((gpio_num_t)TFT_BL);
+
+    // Buttons are pulled up, pressed reads low
+    esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)wakePin, 0);
+    esp_deep_sleep_start();
+}
+
+HalWake halWakeCause()
+{
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause != ESP_SLEEP_WAKEUP_TIMER && cause != ESP_SLEEP_WAKEUP_EXT0)
+    {
+        return HAL_WAKE_RESET;
+    }
+
+    rtc_gpio_hold_dis((gpio_num_t)TFT_BL);
+    rtc_gpio_deinit((gpio_num_t)TFT_BL);
+    return cause == ESP_SLEEP_WAKEUP_TIMER ? HAL_WAKE_TIMER : HAL_WAKE_BUTTON;
+}
+
+bool halMemory(HalMemory &memory)
+{
+    memory.heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    memory.heapMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    memory.heapLargest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    return true;
+}
+
+uint32_t halStackFree(const char *taskName)
+{
+    // Bytes on this port
+    TaskHandle_t task = xTaskGetHandle(taskName);
+    return task ? uxTaskGetStackHighWaterMark(task) : HAL_UNKNOWN;
+}
+
+static const esp_partition_t *findPartition(const char *name)
+{
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, name);
+}
+
+bool halStorageErase(const char *partition, uint32_t size)
+{
+    const esp_partition_t *found = findPartition(partition);
+    size = (size + 4095) & ~4095;  // Flash sectors are 4 KB
+    return found && size <= found->size && esp_partition_erase_range(found, 0, size) == ESP_OK;
+}
+
+bool halStorageWrite(const char *partition, uint32_t offset, const void *data, uint32_t size)
+{
+    const esp_partition_t *found = findPartition(partition);
+    return found && esp_partition_write(found, offset, data, size) == ESP_OK;
+}
+
+bool halStorageRead(const char *partition, uint32_t offset, void *data, uint32_t size)
+{
+    const esp_partition_t *found = findPartition(partition);
+    return found && esp_partition_read(found, offset, data, size) == ESP_OK;
+}
+
+uint32_t IRAM_ATTR halTimerUs()
+{
+    // Not the cycle counter, its rate changes with the power save clock
+    return esp_timer_get_time();
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include "jiggle.h"
+
+// --> Lookup tables, built at compile time in integer arithmetic
+
+// Fixed point: Q15 for weights and unit vectors, Q8 for sub-pixel positions
+#define Q15 32768
+#define Q8 256
+
+template <int N>
+struct Table {
+    int32_t value[N];
+    constexpr int32_t operator[](int i) const { return value[i]; }
+};
+
+// Minimum-jerk position profile s(t) = 10t^3 - 15t^4 + 6t^5, sampled at
+// JIGGLE_PATH_STEPS + 1 points from 0 to 1: slow start, fast middle, slow stop
+constexpr Table<JIGGLE_PATH_STEPS + 1> minimumJerk()
+{
+    Table<JIGGLE_PATH_STEPS + 1> table = {};
+    const int64_t n = JIGGLE_PATH_STEPS;
+    for (int64_t i = 0; i <= n; i++)
+    {
+        int64_t i3 = i * i * i;
+        table.value[i] = (10 * i3 * n * n - 15 * i3 * i * n + 6 * i3 * i * i) * Q15 / (n * n * n * n * n);
+    }
+    return table;
+}
+
+// Sine over one turn in 64 directions, Bhaskara's approximation
+// sin(pi t) ~ 16 t (1 - t) / (5 - 4 t (1 - t)), well within a pixel here
+#define DIRECTIONS 64
+
+constexpr Table<DIRECTIONS> sine()
+{
+    Table<DIRECTIONS> table = {};
+    const int64_t half = DIRECTIONS / 2;
+    for (int64_t i = 0; i < DIRECTIONS; i++)
+    {
+        int64_t x = i % half;
+        int64_t p = x * (half - x);
+        int64_t value = 16 * p * (Q15 - 1) / (5 * half * half - 4 * p);
+        table.value[i] = i < half ? value : -value;
+    }
+    return table;
+}
+
+static constexpr Table<JIGGLE_PATH_STEPS + 1> profile = minimumJerk();
+static constexpr Table<DIRECTIONS> sines = sine();
+
+static_assert(profile[0] == 0 && profile[JIGGLE_PATH_STEPS] == Q15, "profile must run from 0 to 1");
+static_assert(sines[DIRECTIONS / 4] > Q15 - 64, "sine table off at 90 degrees");
+
+static int32_t sinQ15(uint32_t direction)
+{
+    return sines[direction % DIRECTIONS];
+}
+
+static int32_t cosQ15(uint32_t direction)
+{
+    return sines[(direction + DIRECTIONS / 4) % DIRECTIONS];
+}
+
+// --> Path generation, integer only
+
+// One random() call per jiggle seeds this, the rest comes from xorshift
+struct PathRandom {
+    uint32_t state;
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform enough for small ranges, low..high inclusive
+    int range(int low, int high)
+    {
+        return low + (int)(next() % (uint32_t)(high - low + 1));
+    }
+};
+
+struct Point {
+    int32_t x;
+    int32_t y;
+};
+
+// Quadratic Bezier from a through control point c to b, Q8 coordinates
+// and Q15 parameter, returns the position rounded to whole pixels
+static Point bezier(Point a, Point c, Point b, int32_t t)
+{
+    int32_t u = Q15 - t;
+    int32_t wa = (u * u) >> 15;
+    int32_t wc = (2 * u * t) >> 15;
+    int32_t wb = (t * t) >> 15;
+
+    int32_t x = (wa * a.x + wc * c.x + wb * b.x) >> 15;
+    int32_t y = (wa * a.y + wc * c.y + wb * b.y) >> 15;
+    return { (x + Q8 / 2) >> 8, (y + Q8 / 2) >> 8 };
+}
+
+static void addStep(JiggleStep *steps, uint8_t &count, int x, int y, int wheel, uint16_t delay)
+{
+    steps[count].x = x;
+    steps[count].y = y;
+    steps[count].wheel = wheel;
+    steps[count].delay = delay;
+    count++;
+}
+
+// One leg from a to b along a bent curve. Steps are differences of
+// consecutive rounded positions, so they add up to exactly b - a whatever
+// the rounding and jitter in between. Samples that do not move the cursor
+// fold their time into the previous step, or into the first one when no
+// step came before them.
+static void addLeg(JiggleStep *steps, uint8_t &count, PathRandom &rng, const JiggleParams &params, Point a, Point c, Point b)
+{
+    Point last = bezier(a, c, b, 0);
+    uint16_t idle = 0;  // Time of leading samples without a step to take it
+
+    for (int i = 1; i <= JIGGLE_PATH_STEPS; i++)
+    {
+        Point p = bezier(a, c, b, profile[i]);
+
+        // Hand tremor, never on the end point
+        if (i < JIGGLE_PATH_STEPS && (int)(rng.next() % 100) < params.jitter)
+        {
+            p.x += rng.range(-1, 1);
+            p.y += rng.range(-1, 1);
+        }
+
+        int dx = p.x - last.x;
+        int dy = p.y - last.y;
+        last = p;
+
+        if (dx == 0 && dy == 0)
+        {
+            if (count > 0)
+            {
+                steps[count - 1].delay += params.stepInterval;
+            }
+            else
+            {
+                idle += params.stepInterval;
+            }
+            continue;
+        }
+
+        addStep(steps, count, dx, dy, 0, params.stepInterval + idle);
+        idle = 0;
+    }
+}
+
+uint8_t Jiggle::plan(JiggleStep *steps, const JiggleParams &params)
+{
+    uint8_t count = 0;
+    PathRandom rng = { (uint32_t)random(1, 0x7fffffff) };
+
+    // Mouse cursor movement: out along one curve, back along another
+    int distance = rng.range(params.minDistance, params.maxDistance);
+    uint32_t direction = rng.next() % DIRECTIONS;
+    int32_t cx = cosQ15(direction);
+    int32_t cy = sinQ15(direction);
+
+    Point start = { 0, 0 };
+    Point end = { ((distance * cx + Q15 / 2) >> 15) * Q8, ((distance * cy + Q15 / 2) >> 15) * Q8 };
+
+    // Control points off to either side of the straight line, the bend is
+    // a percentage of the distance
+    int32_t outBend = distance * Q8 * rng.range(-params.curve, params.curve) / 100;
+    int32_t backBend = distance * Q8 * rng.range(-params.curve, params.curve) / 100;
+    Point mid = { end.x / 2, end.y / 2 };
+    Point out = { mid.x - ((outBend * cy) >> 15), mid.y + ((outBend * cx) >> 15) };
+    Point back = { mid.x - ((backBend * cy) >> 15), mid.y + ((backBend * cx) >> 15) };
+
+    addLeg(steps, count, rng, params, start, out, end);
+    addLeg(steps, count, rng, params, end, back, start);
+
+    // Random wheel scroll
+    if ((int)(rng.next() % 100) < params.wheelChance)
+    {
+        int scrollAmount = rng.range(params.wheelMin, params.wheelMax);
+        int scrollDirection = (rng.next() & 1) ? 1 : -1;  // Random up or down
+
+        // Scroll in one direction, pause at the peak
+        for (int i = 0; i < scrollAmount; i++)
+        {
+            uint16_t delay = (i == scrollAmount - 1) ? params.wheelStepInterval + params.wheelPeakPause : params.wheelStepInterval;
+            addStep(steps, count, 0, 0, scrollDirection, delay);
+        }
+
+        // Scroll back to original position
+        for (int i = 0; i < scrollAmount; i++)
+        {
+            addStep(steps, count, 0, 0, -scrollDirection, params.wheelStepInterval);
+        }
+    }
+
+    return count;
+}
+
+void Jiggle::start(uint32_t now, const JiggleParams &params, uint16_t stepSlack)
+{
+    count = plan(steps, params);
+    running = true;
+    endsAt = now;
+
+    // The report queue rounds delays up to connection events and may hold a
+    // step back for retries, allow the worst of that so the end is not called early
+    for (uint8_t i = 0; i < count; i++)
+    {
+        endsAt += steps[i].delay + stepSlack;
+    }
+}
+
+void Jiggle::update(uint32_t now)
+{
+    // Signed difference keeps the comparison valid across millis() wraparound
+    if (running && (int32_t)(now - endsAt) >= 0)
+    {
+        running = false;
+    }
+}
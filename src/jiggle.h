@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Upper bound of steps in one jiggle: out and back for the cursor, up and
+// down for the wheel. WHEEL_MAX_SCROLL also caps the runtime setting.
+#define JIGGLE_MAX_STEPS (2 * JIGGLE_PATH_STEPS + 2 * WHEEL_MAX_SCROLL)
+#define JIGGLE_DISTANCE_LIMIT 50  // Largest distance a setting may ask for, steps stay well within a byte
+
+// Shape of a jiggle, set at runtime through the tunables. Part of the
+// tunables blob, the layout is fixed.
+struct JiggleParams {
+    uint8_t minDistance;
+    uint8_t maxDistance;
+    uint8_t curve;        // Percent
+    uint8_t jitter;       // Percent
+    uint8_t wheelChance;  // Percent
+    uint8_t wheelMin;
+    uint8_t wheelMax;     // Up to WHEEL_MAX_SCROLL
+    uint8_t reserved;
+    uint16_t stepInterval;       // Milliseconds
+    uint16_t wheelStepInterval;
+    uint16_t wheelPeakPause;
+};
+
+#define JIGGLE_PARAMS_DEFAULT { JIGGLE_MIN_DISTANCE, JIGGLE_MAX_DISTANCE, JIGGLE_CURVE, JIGGLE_JITTER, \
+    WHEEL_SCROLL_CHANCE, WHEEL_MIN_SCROLL, WHEEL_MAX_SCROLL, 0, JIGGLE_STEP_INTERVAL, WHEEL_STEP_INTERVAL, WHEEL_PEAK_PAUSE }
+
+struct JiggleStep {
+    int8_t x;
+    int8_t y;
+    int8_t wheel;
+    uint16_t delay;  // Time to wait after this step before the next one (milliseconds)
+};
+
+// Non-blocking jiggle: start() plans the whole movement, which is handed to
+// the HID report queue in one go. The jiggle stays active until the last
+// step has had time to go out, update() notices when that has passed.
+class Jiggle
+{
+public:
+    // stepSlack: the most each step may take on top of its delay (milliseconds)
+    void start(uint32_t now, const JiggleParams &params, uint16_t stepSlack);
+    void update(uint32_t now);
+    bool active() const { return running; }
+    void cancel() { running = false; }
+    uint32_t due() const { return endsAt; }
+    const JiggleStep *path() const { return steps; }
+    uint8_t length() const { return count; }
+
+    // Plan a movement without scheduling it
+    static uint8_t plan(JiggleStep *steps, const JiggleParams &params);
+
+private:
+    JiggleStep steps[JIGGLE_MAX_STEPS];
+    uint8_t count = 0;
+    bool running = false;
+    uint32_t endsAt = 0;
+};
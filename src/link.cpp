@@ -0,0 +1,67 @@
+#include <Arduino.h>
+#include "link.h"
+
+void LinkControl::reset(uint8_t host)
+{
+    filtered[host] = 0;
+    margin[host] = 0;
+    level[host] = MOUSE_TX_DEFAULT_DBM;
+}
+
+int8_t LinkControl::update(uint8_t host, int8_t rssi, bool failed)
+{
+    if (rssi != 0)
+    {
+        // Fast attack, slow release, in 1/16 dB
+        int16_t sample = rssi * 16;
+        if (filtered[host] == 0)
+        {
+            filtered[host] = sample;
+        }
+        else
+        {
+            filtered[host] += (sample - filtered[host]) / (sample < filtered[host] ? 2 : 8);
+        }
+    }
+
+    if (failed)
+    {
+        margin[host] = min(margin[host] + LINK_FAIL_MARGIN, LINK_MARGIN_MAX);
+    }
+    else if (margin[host] > 0)
+    {
+        margin[host]--;
+    }
+
+    // Nothing to go by before the first reading
+    if (filtered[host] == 0)
+    {
+        return level[host];
+    }
+
+    // Least power step that reaches the target, rounded up
+    int required = LINK_TARGET_RSSI + LINK_HOST_TX - this->rssi(host) + margin[host];
+    int next = MOUSE_TX_MIN_DBM;
+    while (next < required && next < MOUSE_TX_MAX_DBM)
+    {
+        next += MOUSE_TX_STEP_DB;
+    }
+
+    // Up right away, down only with room to spare
+    if (next > level[host])
+    {
+        level[host] = next;
+        raises++;
+    }
+    else if (next < level[host] && required <= level[host] - MOUSE_TX_STEP_DB - LINK_HYSTERESIS)
+    {
+        level[host] = next;
+        lowers++;
+    }
+    return level[host];
+}
+
+bool LinkControl::weak(uint8_t host) const
+{
+    return filtered[host] != 0 && rssi(host) < LINK_WEAK_RSSI;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <BleMouse.h>
+#include "config.h"
+
+// Closed-loop TX power, one loop per host. The RSSI of what the host sends
+// stands in for the path loss both ways (the host is assumed to transmit at
+// LINK_HOST_TX), the power is the least that gets LINK_TARGET_RSSI to the
+// host plus a margin. Readings that drop are taken in fast and rises slowly,
+// and a failed notification adds margin, so the power goes up ahead of a
+// fade and comes down only once the link has stayed good.
+class LinkControl
+{
+public:
+    void reset(uint8_t host);
+
+    // New RSSI reading (0 for none yet) and whether notifications failed
+    // since the last one. Returns the TX power to use, dBm.
+    int8_t update(uint8_t host, int8_t rssi, bool failed);
+
+    int8_t rssi(uint8_t host) const { return (filtered[host] + 8) >> 4; }  // Filtered, 0 before a reading
+    int8_t power(uint8_t host) const { return level[host]; }
+    bool weak(uint8_t host) const;  // Below LINK_WEAK_RSSI, likely to drop
+
+    uint32_t raises = 0;
+    uint32_t lowers = 0;
+
+private:
+    int16_t filtered[BLE_MAX_HOSTS] = {};  // dBm in 1/16 steps
+    uint8_t margin[BLE_MAX_HOSTS] = {};    // dB on top of the target
+    int8_t level[BLE_MAX_HOSTS] = {};
+};
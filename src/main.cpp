@@ -1,183 +1,197 @@
 #include <Arduino.h>
 #include <BleMouse.h>
+#include <Preferences.h>
+#include "config.h"
+#if UI_DISPLAY
 #include <SPI.h>
 #include <TFT_eSPI.h>
-#include <Preferences.h>
-
-// Bluetooth Configs
-#define X_RANDOM_RANGE 3
-#define Y_RANDOM_RANGE 3
-#define JIGGLE_STEP_INTERVAL 50
-#define JIGGLE_MIN_DISTANCE 1        // Smaller movements (1-5 pixels)
-#define JIGGLE_MAX_DISTANCE 5
-#define JIGGLE_TIME_VARIANCE 20000   // +/- 20 seconds random timing variance (in milliseconds)
-#define WHEEL_SCROLL_CHANCE 50      // 50% chance to include wheel scroll
-#define WHEEL_MIN_SCROLL 1          // Minimum scroll amount
-#define WHEEL_MAX_SCROLL 3          // Maximum scroll amount
-#define INTERVAL_LIST { 60, 90, 180, 300, 600, 900 }
-#define DEFAULT_INTERVAL 2
-#define NUM_CHANNELS 3
-
-// Display Configs
-#define DISPLAY_UPDATE_INTERVAL 1000  // Display refresh rate (milliseconds)
-
-// Button Configs
-#define BUTTON_UP 0
-#define BUTTON_DOWN 35
-#define DEBOUNCE_DELAY 250
-#define LONG_PRESS 1000
-
-// Backlight pin for TTGO T-Display
-#ifndef TFT_BL
-#define TFT_BL 4
+#include "backlight.h"
+#include "renderer.h"
 #endif
-
-// Types
-#define BUTTON_NONE 0
-#define BUTTON_PRESS 1
-#define BUTTON_LONGPRESS 2
-
-struct ButtonState {
-    bool init;
-    u_int64_t pressed;
-    u_int64_t longpress;
-    u_int64_t released;
-};
+#include "boot.h"
+#include "buttons.h"
+#include "hal.h"
+#include "jiggle.h"
+#include "link.h"
+#include "power.h"
+#include "probe.h"
+#include "protocol.h"
+#include "schedule.h"
+#include "scheduler.h"
+#include "seqlock.h"
+#include "settings.h"
+#include "spsc.h"
+#include "trace.h"
+#include "tunables.h"
+#include "ui.h"
 
 // Initialize Bluetooth
-BleMouse bleMouse("Logitech M510", "Logitech", 100);
+BleMouse bleMouse(BLE_DEVICE_NAME, BLE_MANUFACTURER, 100);
 
+#if UI_DISPLAY
 // Initialize Display
 TFT_eSPI display;
+Renderer renderer(display);
+Backlight backlight(display);
+#endif
 
-// Initialize preferences from flash
+// Initialize preferences from flash, written back lazily
 Preferences preferences;
+Settings settings(preferences);
+Tunables tunables(preferences);
 
-// --> Functions
+// Everything loop() does is triggered through the scheduler
+Scheduler scheduler;
 
-void moveMouse()
-{
-    // Mouse cursor movement
-    int distance = random(JIGGLE_MIN_DISTANCE, JIGGLE_MAX_DISTANCE);
-    int x = random(X_RANDOM_RANGE) - 1;
-    int y = random(Y_RANDOM_RANGE) - 1;
+// Clock and sleep policy, energy estimate
+Power power;
 
-    for (int i = 0; i < distance; i++)
-    {
-        bleMouse.move(x, y);
-        delay(JIGGLE_STEP_INTERVAL);
-    }
+// Time from reset to the first report, per phase
+BootTimer boot;
 
-    for (int i = 0; i < distance; i++)
-    {
-        bleMouse.move(0 - x, 0 - y);
-        delay(JIGGLE_STEP_INTERVAL);
-    }
+// Weekly active windows, in effect once the host has set the clock
+const ScheduleWindow windows[] = SCHEDULE_LIST;
+Schedule schedule(windows, sizeof(windows) / sizeof(windows[0]));
 
-    // Random wheel scroll (50% chance)
-    if (random(100) < WHEEL_SCROLL_CHANCE)
-    {
-        int scrollAmount = random(WHEEL_MIN_SCROLL, WHEEL_MAX_SCROLL + 1);
-        int scrollDirection = (random(2) == 0) ? 1 : -1;  // Random up or down
-        int totalScroll = scrollAmount * scrollDirection;
+// Engine to UI and back, see ui.h
+Seqlock<UiState> uiState;
+SpscQueue<UiCommand, COMMAND_QUEUE_SIZE> uiCommands;
+bool uiThreaded = false;  // UI runs on its own core, otherwise inline from loop()
+uint32_t uiChargeUs = 0;  // UI work for the energy estimate, taken by loop()
 
-        // Scroll in one direction (slower for smoother scrolling)
-        for (int i = 0; i < scrollAmount; i++)
-        {
-            bleMouse.move(0, 0, scrollDirection);
-            delay(200);  // Slower scroll speed (200ms between notches)
-        }
+// Buttons, fed from pin interrupts, read by the UI
+ButtonQueue buttonEdges;
+Button buttonTop;
+Button buttonBottom;
 
-        delay(300);  // Longer pause at scroll peak
+// --> Functions
 
-        // Scroll back to original position
-        for (int i = 0; i < scrollAmount; i++)
-        {
-            bleMouse.move(0, 0, -scrollDirection);
-            delay(200);  // Slower scroll speed (200ms between notches)
-        }
-    }
+void setMac()
+{
+    // mac address
+    // https://generate.plus/en/address/mac
+    // BLE_MAC_BASE by default, matches Logitech M510. The 16-bit report map
+    // is a different device to hosts, keep pairings of both apart.
+    uint8_t new_mac[6];
+    memcpy(new_mac, tunables.get().mac, sizeof(new_mac));
+    new_mac[4] += MOUSE_HIRES ? 0x10 : 0;
+    halSetBaseMac(new_mac);
 }
 
-short buttonState(int pin, unsigned long now, ButtonState *buttonState)
+void IRAM_ATTR buttonTopEdge()
 {
-    if (buttonState->init == false && digitalRead(pin) == HIGH)
-    {
-        // first unpressed state registered
-        buttonState->init = true;
-    }
-    else if(buttonState->init == false)
-    {
-        // button was pressed before firmware started, ignore
-        return BUTTON_NONE;
-    }
+    buttonEdges.push({ (uint32_t)millis(), 0, (uint8_t)digitalRead(BUTTON_UP) });
+    halUiWake();
+}
 
-    if (buttonState->pressed == 0 && digitalRead(pin) == LOW)
-    {
-        // button pressed
-        buttonState->pressed = millis();
-    }
-    else if (buttonState->pressed > 0 && buttonState->released == 0 && buttonState->longpress == 0 && digitalRead(pin) == LOW)
-    {
-        // button still pressed
-        if (millis() - buttonState->pressed > LONG_PRESS)
-        {
-            // it was a long press
-            buttonState->longpress = millis();
-            return BUTTON_LONGPRESS;
-        }
-    }
-    else if (buttonState->pressed > 0 && buttonState->released == 0 && digitalRead(pin) == HIGH)
-    {
-        // button was released
-        buttonState->released = millis();
-        if (buttonState->longpress == 0)
-        {
-            // no longpress recorded, so it's a short press
-            return BUTTON_PRESS;
-        }
-    }
-    else if (buttonState->pressed > 0 && buttonState->released > 0 && millis() - buttonState->released > DEBOUNCE_DELAY)
-    {
-        // button released, debounce time expired
-        buttonState->pressed = 0;
-        buttonState->released = 0;
-        buttonState->longpress = 0;
-    }
+void IRAM_ATTR buttonBottomEdge()
+{
+    buttonEdges.push({ (uint32_t)millis(), 1, (uint8_t)digitalRead(BUTTON_DOWN) });
+    halUiWake();
+}
 
-    return BUTTON_NONE;
+void connectionChanged()
+{
+    // Runs on the BLE task
+    scheduler.post(EVENT_CONNECTION);
 }
 
-// --> Global State Variables
+void reportSent(const MouseReport &report)
+{
+    // Runs on the report task
+    trace.sent(millis(), report);
+}
+
+void serialReceived()
+{
+    // Runs on the UART event task
+    scheduler.post(EVENT_SERIAL);
+}
+
+#if UI_DISPLAY
+float displayCurrent()
+{
+    // Read from loop(), the backlight belongs to the display task
+    return backlight.averageMa();
+}
+#endif
+
+#if PROBES
+void notifyTimed(uint32_t us)
+{
+    // Runs on the report task
+    probes.record(PROBE_NOTIFY, us);
+}
+#endif
+
+// Defined further down, next to the code they belong to
+void publish(bool force);
+void uiTask();
+void applyTunables();
+
+// --> Engine State, owned by loop()
 
 // Bluetooth & Connection State
-unsigned short bluetoothChannelOffset = 0;
 bool running = true;
 bool connected = false;
 bool newConnectState = false;
+uint8_t hosts = 0;  // Bit per connected host slot
+uint16_t reconnects = 0;
+bool linkFast = false;  // Fast connection parameter profile requested
+uint32_t linkSettleAt = 0;
+bool linkSettled = true;  // Cleared on a new connection until linkSettleAt
+LinkControl linkControl;  // TX power per host
+uint32_t linkFailed = 0;  // bleMouse.reportsFailed at the last RSSI sample
+uint8_t weakHosts = 0;  // Bit per host below LINK_WEAK_RSSI
 
 // Timing & Jiggle State
-unsigned long now = 0;
-unsigned long lastJiggle;
+uint32_t now = 0;
+uint32_t lastJiggle;
 int nextJiggleDiff;
-int intervals[] = INTERVAL_LIST;
-size_t numIntervals = sizeof(intervals) / sizeof(intervals[0]);
+int intervals[INTERVAL_MAX_COUNT];  // From the tunables
+size_t numIntervals = 0;
 int current_interval;
 int jiggle_interval;
 unsigned long jiggleCount = 0;  // Total number of jiggles since boot
+Jiggle jiggle;  // Movement in progress, sent by the BleMouse report queue
+
+// Schedule State
+bool inWindow = true;  // Also without a clock
+bool holdAwake = false;  // Button pressed outside the windows, stay up until awakeUntil
+uint32_t awakeUntil = 0;
+bool asleep = false;  // halDeepSleep() returned, only in the simulator
+char serialLine[24];  // Command line coming in on serial
+uint8_t serialLength = 0;
+ConfigParser configParser;  // Binary frames in between
+
+// Scheduler Statistics
+uint32_t lastStats = 0;
+uint32_t lastWakeups = 0;
+
+// Published to the UI when it changes
+UiState published;
+
+// --> UI State, owned by the display task
 
 // Button State Variables
-ButtonState buttonStateTop;
-ButtonState buttonStateBottom;
 short buttonResult;
+bool wakePress = false;  // The press woke the panel, it does nothing else
 
 // Display State Variables
-unsigned long lastDisplayUpdate = 0;
-bool dirty = true;
-bool fullRedraw = true;  // Flag for full screen redraw vs partial update
-int lastDisplayedSeconds = -1;  // Track last displayed countdown to avoid unnecessary redraws
-int lastProgress = -1;  // Track last progress bar value
-char s [22];  // String buffer for display formatting
+UiState shown;
+uint32_t shownVersion = UINT32_MAX;
+uint32_t lastDisplayUpdate = 0;
+uint32_t uiDeadline = 0;
+bool uiDeadlineArmed = false;
+char s [32];  // String buffer for display formatting
+
+#if UI_DISPLAY
+// Display Start-up Variables
+bool displayReady = false;
+bool splashing = false;
+uint32_t splashUntil = 0;
+uint32_t splashFrameAt = 0;
+int8_t bootAnim = 0;
 
 // Display Animation Variables
 char animation[] = { '|', '/', '-', '\\' };  // Rotating line animation
@@ -186,112 +200,322 @@ int8_t i_animation = 0;
 int8_t i_rainbow = 0;  // Rainbow color index for spinner
 uint16_t rainbowColors[] = { TFT_RED, TFT_ORANGE, TFT_YELLOW, TFT_GREEN, TFT_CYAN, TFT_BLUE, TFT_MAGENTA };
 size_t numRainbowColors = sizeof(rainbowColors) / sizeof(rainbowColors[0]);
+#endif
 
 void setup()
 {
+    boot.begin(millis());
+
     // Serial
     Serial.begin(115200);
     Serial.println();
     Serial.println();
+    Serial.printf("profile: %s\n", UiPolicy::name);
+    Serial.onReceive(serialReceived);
+
+    // Back from deep sleep the clock still runs, the settings are in flash.
+    // A button wake stays up for a while so the screen can be read.
+    HalWake wake = halWakeCause();
+    asleep = false;
+    holdAwake = wake == HAL_WAKE_BUTTON;
+    awakeUntil = millis() + SCHEDULE_WAKE_HOLD * 1000;
+    uint32_t local;
+    if (wake != HAL_WAKE_RESET)
+    {
+        Serial.printf("wake: %s\n", wake == HAL_WAKE_TIMER ? "timer" : "button");
+    }
+    else if (SCHEDULE_ENABLED && !halLocalTime(local))
+    {
+        Serial.println("schedule: clock not set, active around the clock");
+    }
 
     // Preferences
     preferences.begin("app", false);
-    current_interval = preferences.getShort("intv", DEFAULT_INTERVAL);
-    jiggle_interval = intervals[current_interval] * 1000;
-    running = preferences.getBool("isrunning", true);
-
-    // mac address
-    // https://generate.plus/en/address/mac
-    // Logitech Inc
-    bluetoothChannelOffset = preferences.getUShort("macoffset", 0);
-    uint8_t macoffset = 0xAE + bluetoothChannelOffset;
+    settings.begin();
+    tunables.begin();
+    current_interval = settings.interval();
+    applyTunables();
+    running = settings.running();
+    boot.mark(BOOT_SETTINGS, millis());
+    if (trace.load())
+    {
+        Serial.printf("trace: %u records restored\n", trace.records);
+    }
 
-    // Original mac configuration
-    //uint8_t new_mac[6] = { 0xEC, 0x81, 0x93, 0x37, macoffset, 0xCB };
-    
-    // Matches Logitech M510
-    uint8_t new_mac[6] = { 0x00, 0x1F, 0x20, 0x37, macoffset, 0xCB };
-    esp_base_mac_addr_set(new_mac);
+    // Bluetooth first, the sooner it advertises the sooner a host reconnects
+    setMac();
+    bleMouse.setDeviceName(tunables.get().name);
+    bleMouse.setConnectionCallback(connectionChanged);
+    bleMouse.setSentCallback(reportSent);
+    bleMouse.setReportFormat(MOUSE_HIRES ? MOUSE_FORMAT_16BIT : MOUSE_FORMAT_8BIT);
+#if PROBES
+    bleMouse.setSendProbe(notifyTimed);
+#endif
+    bleMouse.begin();
+    boot.mark(BOOT_BLE, millis());
 
     // Button pins
     pinMode(BUTTON_UP, INPUT_PULLUP);
     pinMode(BUTTON_DOWN, INPUT_PULLUP);
 
-    // Bluetooth
-    bleMouse.begin();
+    // Button edges are queued from interrupts
+    buttonTop.begin(digitalRead(BUTTON_UP));
+    buttonBottom.begin(digitalRead(BUTTON_DOWN));
+    attachInterrupt(digitalPinToInterrupt(BUTTON_UP), buttonTopEdge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(BUTTON_DOWN), buttonBottomEdge, CHANGE);
 
-    // Display backlight
+#if !UI_DISPLAY
+    // Nothing drives the panel, keep the backlight off
     pinMode(TFT_BL, OUTPUT);
-    digitalWrite(TFT_BL, HIGH);  // Turn on backlight
+    digitalWrite(TFT_BL, LOW);
+#endif
+
+    // The UI sets up the display itself, on the other core if there is one,
+    // while BLE comes up. Headless, the buttons are handled from loop().
+    publish(true);
+    if constexpr (UiPolicy::display)
+    {
+        uiThreaded = halStartUiTask(uiTask);
+    }
+
+    // Initialize random seed for varied mouse movement patterns
+    randomSeed(halRandomSeed());
+
+    lastJiggle = millis();
+    lastStats = lastJiggle;
+    power.begin(lastJiggle, wake != HAL_WAKE_RESET);
+#if UI_DISPLAY
+    power.displayMa = displayCurrent;
+#endif
 
+    // Pick up the initial connection state
+    scheduler.post(EVENT_CONNECTION);
+    scheduler.arm(EVENT_STATS, lastStats + STATS_INTERVAL);
+    boot.mark(BOOT_SETUP, millis());
+}
+
+// --> UI, on the display task or inline from loop()
+
+void sendCommand(UiCommand command)
+{
+    uiCommands.push(command);
+    if (uiThreaded)
+    {
+        scheduler.post(EVENT_COMMAND);
+    }
+}
+
+// Next time the UI has to run without an edge or a new snapshot
+void uiWakeAt(uint32_t when)
+{
+    if (!uiDeadlineArmed || (int32_t)(when - uiDeadline) < 0)
+    {
+        uiDeadline = when;
+        uiDeadlineArmed = true;
+    }
+}
+
+#if UI_DISPLAY
+
+// Glyphs and sprites for the status screen, replaces the boot message
+void screenBegin()
+{
+    renderer.begin();
+    shownVersion = UINT32_MAX;  // Draw whatever the snapshot is now
+    boot.mark(BOOT_SCREEN, millis());
+}
+
+// First thing the UI does. On its own core this overlaps with the BLE
+// start-up instead of holding up setup().
+void displayBegin(uint32_t now)
+{
     // Display
     display.init();
     display.setRotation(1);  // Rotate to landscape (becomes 240x135)
+
+    // Display backlight, on LEDC PWM. Only after init(): TFT_eSPI switches
+    // TFT_BL on as plain GPIO, which detaches the pin from LEDC again.
+    backlight.begin(now);
     display.fillScreen(TFT_BLACK);
-    display.setTextSize(3);  // Bigger text size
-    display.setTextColor(TFT_WHITE);
-
-    // Boot message
-    display.setCursor(5, 10);
-    display.print("Mouse");
-    display.setCursor(5, 40);
-    display.print("Jiggler");
-    display.setTextSize(2);
-    display.setCursor(5, 80);
-    display.print("Starting...");
-    unsigned long bootStart = millis();
-    int8_t bootAnim = 0;
-    while (millis() - bootStart < 2000)
+    boot.mark(BOOT_DISPLAY, millis());
+
+    // Boot message, only after power-on: back from a crash or a restart the
+    // status screen should be up again right away
+    if constexpr (UiPolicy::animations)
+    {
+        if (BOOT_SPLASH_TIME > 0 && !halWarmBoot())
+        {
+            display.setTextSize(3);  // Bigger text size
+            display.setTextColor(TFT_WHITE);
+            display.setCursor(5, 10);
+            display.print("Mouse");
+            display.setCursor(5, 40);
+            display.print("Jiggler");
+            display.setTextSize(2);
+            display.setCursor(5, 80);
+            display.print("Starting...");
+
+            splashing = true;
+            splashUntil = now + BOOT_SPLASH_TIME;
+            splashFrameAt = now;
+            return;
+        }
+    }
+
+    screenBegin();
+}
+
+// Animates the boot message until BOOT_SPLASH_TIME is up, false after that
+bool splash(uint32_t now)
+{
+    if ((int32_t)(now - splashUntil) >= 0)
+    {
+        splashing = false;
+        screenBegin();
+        return false;
+    }
+
+    if ((int32_t)(now - splashFrameAt) >= 0)
     {
         display.setTextSize(2);
         display.setCursor(200, 80);
         display.print(animation[bootAnim]);
         bootAnim = (bootAnim + 1) % numAnimations;
-        delay(200);
+        splashFrameAt = now + BOOT_SPLASH_FRAME;
     }
-
-    // Initialize random seed for varied mouse movement patterns
-    randomSeed(esp_random());
-
-    lastJiggle = millis();
+    uiWakeAt(splashFrameAt);
+    uiWakeAt(splashUntil);
+    return true;
 }
 
-void loop()
+#endif
+
+void handleButtons(uint32_t now)
 {
-    now = millis();
+    ButtonEdge edge;
+    while (buttonEdges.pop(edge))
+    {
+        (edge.button == 0 ? buttonTop : buttonBottom).edge(edge.time, edge.level);
+#if UI_DISPLAY
+        if (backlight.activity(now))
+        {
+            wakePress = true;
+        }
+#endif
+    }
+    if (buttonEdges.overflowed())
+    {
+        // Edges were lost, the current levels are what matters
+        buttonTop.edge(now, digitalRead(BUTTON_UP));
+        buttonBottom.edge(now, digitalRead(BUTTON_DOWN));
+    }
 
-    if (connected && running && now - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL)
+    buttonResult = buttonTop.update(now);
+    if (buttonResult != BUTTON_NONE && wakePress)
+    {
+        wakePress = false;
+    }
+    else if (buttonResult == BUTTON_PRESS)
     {
-        dirty = true;
+        sendCommand(COMMAND_TOGGLE_RUNNING);
     }
 
-    buttonResult = buttonState(BUTTON_UP, now, &buttonStateTop);
-    if (buttonResult == BUTTON_PRESS)
+    buttonResult = buttonBottom.update(now);
+    if (buttonResult != BUTTON_NONE && wakePress)
     {
-        running = !running;
-        dirty = true;
-        fullRedraw = true;  // State changed, need full redraw
-        lastJiggle = now;
+        wakePress = false;
+    }
+    else if (buttonResult == BUTTON_PRESS)
+    {
+        sendCommand(COMMAND_NEXT_INTERVAL);
+    }
+    else if (buttonResult == BUTTON_LONGPRESS)
+    {
+        sendCommand(COMMAND_DISCONNECT_HOSTS);
+    }
 
-        preferences.putBool("isrunning", running);
+    // Come back when a settle, long press or debounce time runs out
+    uiDeadlineArmed = false;
+    uint32_t when;
+    if (buttonTop.deadline(when))
+    {
+        uiWakeAt(when);
     }
+    if (buttonBottom.deadline(when))
+    {
+        uiWakeAt(when);
+    }
+}
+
+// --> Engine, in loop()
 
-    buttonResult = buttonState(BUTTON_DOWN, now, &buttonStateBottom);
-    if (buttonResult == BUTTON_PRESS)
+void handleCommands()
+{
+    UiCommand command;
+    while (uiCommands.pop(command))
     {
-        dirty = true;
-        fullRedraw = true;  // Interval changed, need full redraw
-        current_interval = (current_interval + 1) % numIntervals;
-        jiggle_interval = intervals[current_interval] * 1000;
-        lastJiggle = now;
-        preferences.putShort("intv", current_interval);
+        // Someone is at the device, do not go to sleep on them
+        holdAwake = true;
+        awakeUntil = now + SCHEDULE_WAKE_HOLD * 1000;
+
+        if (command == COMMAND_TOGGLE_RUNNING)
+        {
+            running = !running;
+            lastJiggle = now;
+            settings.setRunning(running, now);
+        }
+        else if (command == COMMAND_NEXT_INTERVAL)
+        {
+            current_interval = (current_interval + 1) % numIntervals;
+            jiggle_interval = intervals[current_interval] * 1000;
+            lastJiggle = now;
+            settings.setInterval(current_interval, now);
+        }
+        else if (command == COMMAND_DISCONNECT_HOSTS)
+        {
+            // All hosts stay connected at once, a long press frees the slots so
+            // a new host can pair when they are all taken
+            bleMouse.disconnectAll();
+        }
     }
-    else if (buttonResult == BUTTON_LONGPRESS)
+}
+
+void handleConnection()
+{
+    uint8_t newHosts = bleMouse.hosts();
+    if (newHosts != hosts)
     {
-        preferences.putUShort("macoffset", (preferences.getUShort("macoffset", 0) + 1) % NUM_CHANNELS);
+        for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+        {
+            if ((newHosts ^ hosts) & (1 << host))
+            {
+                Serial.printf("BLE host %u %s\n", host + 1, (newHosts & (1 << host)) ? "connected" : "disconnected");
+            }
+        }
+
+        // Let pairing and service discovery finish before asking for new
+        // parameters. Centrals start with a short interval, so treat it as fast.
+        if (newHosts & ~hosts)
+        {
+            linkFast = true;
+            linkSettleAt = now + BLE_SETTLE_DELAY;
+            linkSettled = false;
+
+            // New hosts start at the default power, the first reading comes
+            // in before the next sample
+            for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+            {
+                if (newHosts & ~hosts & (1 << host))
+                {
+                    linkControl.reset(host);
+                }
+            }
+            bleMouse.readRssi();
+            scheduler.arm(EVENT_RSSI, now + LINK_RSSI_INTERVAL);
+        }
+        weakHosts &= newHosts;
 
-        // Restart required to apply new Bluetooth MAC address
-        ESP.restart();
+        hosts = newHosts;
     }
 
     newConnectState = bleMouse.isConnected();
@@ -299,138 +523,738 @@ void loop()
     {
         connected = newConnectState;
         jiggle_interval = intervals[current_interval] * 1000;
-        dirty = true;
-        fullRedraw = true;  // Connection state changed, need full redraw
+
+        if (connected && !boot.reached(BOOT_CONNECTED))
+        {
+            boot.mark(BOOT_CONNECTED, now);
+            boot.report();
+        }
 
         if (!connected)
         {
-            // Restart ESP to reliably reconnect BLE
-            ESP.restart();
+            // Remaining steps would land on the next connection, drop them
+            bleMouse.clearQueue();
+            jiggle.cancel();
+        }
+        else if (bleMouse.reconnects() != reconnects)
+        {
+            // BleMouse advertises again on its own after a disconnect
+            reconnects = bleMouse.reconnects();
+            Serial.printf("BLE reconnected after %u ms (%u reconnects)\n", bleMouse.reconnectLatency(), reconnects);
         }
     }
+}
 
-    nextJiggleDiff = jiggle_interval - (now - lastJiggle);
+// Longest a jiggle step can take past its delay: the wait for the slowest
+// host's connection event, and as many more as a host that missed it gets
+uint16_t jiggleStepSlack()
+{
+    uint16_t interval = BLE_FAST_INTERVAL_MAX;
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if (bleMouse.hosts() & (1 << host))
+        {
+            interval = max(interval, bleMouse.connInterval(host));
+        }
+    }
+    return (interval * 5 + 3) / 4 * (1 + MOUSE_RETRY_MAX);
+}
+
+void queueJiggle()
+{
+    // The whole path goes out in one call, the report task paces it so a
+    // started jiggle runs to completion and the cursor returns to where it was
+    static_assert(JIGGLE_MAX_STEPS < MOUSE_QUEUE_SIZE, "a jiggle must fit the report queue");
+    MouseReport reports[JIGGLE_MAX_STEPS];
+    const JiggleStep *steps = jiggle.path();
+    uint8_t count = jiggle.length();
+    int16_t notch = bleMouse.wheelResolution();  // Units, with the 16-bit format
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        reports[i] = { 0, steps[i].x, steps[i].y, (int16_t)(steps[i].wheel * notch), 0, steps[i].delay };
+    }
+
+    if (!bleMouse.enqueue(reports, count))
+    {
+        // Queue still busy, nothing was sent so there is nothing to undo
+        jiggle.cancel();
+    }
+    else if (!boot.reached(BOOT_REPORT))
+    {
+        boot.mark(BOOT_REPORT, now);
+        boot.report();
+    }
+}
+
+// Takes over the tunables after boot or a change. The interval list may
+// have become shorter than the selected entry.
+void applyTunables()
+{
+    numIntervals = tunables.intervalCount();
+    for (size_t i = 0; i < numIntervals; i++)
+    {
+        intervals[i] = tunables.get().intervals[i];
+    }
+    if (current_interval >= (int)numIntervals)
+    {
+        current_interval = min(DEFAULT_INTERVAL, (int)numIntervals - 1);
+    }
+    jiggle_interval = intervals[current_interval] * 1000;
+    trace.variance = tunables.get().timeVariance;
+}
+
+// One complete line from serial
+void handleSerialLine(const char *line)
+{
+    unsigned long utc;
+    int offset;
+    if (line[0] == SCHEDULE_CLOCK_COMMAND && sscanf(line + 1, "%lu %d", &utc, &offset) == 2)
+    {
+        halSetClock(utc, offset);
+        Serial.printf("clock: set to %lu, UTC%+d min\n", utc, offset);
+    }
+}
+
+void handleConfigFrame(const ConfigFrame &frame)
+{
+    uint8_t reply[CONFIG_PAYLOAD_MAX];
+    uint8_t length = 1;
+    uint8_t status = CONFIG_BAD_OP;
+    static_assert(sizeof(TunablesRecord) + 1 <= CONFIG_PAYLOAD_MAX, "the blob has to fit a frame");
+
+    if (frame.op == CONFIG_GET && frame.length == 1)
+    {
+        uint8_t size = 0;
+        status = tunables.read(frame.payload[0], reply + 2, size);
+        reply[1] = frame.payload[0];
+        length = status == TUNABLES_OK ? 2 + size : 1;
+    }
+    else if (frame.op == CONFIG_SET && frame.length >= 1)
+    {
+        status = tunables.write(frame.payload[0], frame.payload + 1, frame.length - 1);
+    }
+    else if (frame.op == CONFIG_EXPORT && frame.length == 0)
+    {
+        status = TUNABLES_OK;
+        memcpy(reply + 1, &tunables.get(), sizeof(TunablesRecord));
+        length = 1 + sizeof(TunablesRecord);
+    }
+    else if (frame.op == CONFIG_IMPORT)
+    {
+        status = tunables.import(frame.payload, frame.length);
+    }
+    else if (frame.op == CONFIG_DEFAULTS && frame.length == 0)
+    {
+        status = tunables.reset();
+    }
+    else if (frame.op == CONFIG_RESTART && frame.length == 0)
+    {
+        status = TUNABLES_OK;
+    }
+    else if (frame.op == CONFIG_GET || frame.op == CONFIG_SET || frame.op == CONFIG_EXPORT ||
+        frame.op == CONFIG_DEFAULTS || frame.op == CONFIG_RESTART)
+    {
+        status = TUNABLES_BAD_LENGTH;
+    }
+
+    if (status == TUNABLES_OK || status == TUNABLES_OK_RESTART)
+    {
+        applyTunables();
+    }
+    reply[0] = status;
+    sendConfigFrame(frame.op | CONFIG_REPLY, frame.seq, reply, length);
 
-    if (dirty)
+    if (frame.op == CONFIG_RESTART && status == TUNABLES_OK)
     {
-        display.setTextSize(3);  // Bigger text throughout
+        // Name and MAC are only picked up at boot
+        Serial.flush();
+        settings.flush();
+        trace.flush(now);
+        halRestart();
+    }
+}
+
+void handleSerial()
+{
+    while (Serial.available() > 0)
+    {
+        char c = Serial.read();
+        uint8_t parsed = configParser.feed(c, now);
+        if (parsed == CONFIG_PARSE_FRAME)
+        {
+            handleConfigFrame(configParser.frame());
+        }
+        else if (parsed == CONFIG_PARSE_ERROR)
+        {
+            // The host sends it again on a bad CRC, not when it was too long
+            uint8_t status = configParser.frame().length > CONFIG_PAYLOAD_MAX ? TUNABLES_BAD_LENGTH : CONFIG_BAD_CRC;
+            sendConfigFrame(configParser.frame().op | CONFIG_REPLY, configParser.frame().seq, &status, 1);
+        }
+        if (parsed != CONFIG_PARSE_TEXT)
+        {
+            continue;
+        }
+
+        if (c == TRACE_DUMP_COMMAND && serialLength == 0)
+        {
+            // A single byte, no line end needed
+            trace.sendFrame(now);
+        }
+        else if (c == '\n' || c == '\r')
+        {
+            serialLine[serialLength] = '\0';
+            handleSerialLine(serialLine);
+            serialLength = 0;
+        }
+        else if (serialLength < sizeof(serialLine) - 1)
+        {
+            serialLine[serialLength++] = c;
+        }
+    }
+}
+
+// Clock and settings survive deep sleep, everything else starts over in
+// setup() on the way back
+void sleepUntilWindow(uint32_t seconds, uint32_t local)
+{
+    Serial.printf("schedule: sleeping %u s\n", seconds);
+    Serial.flush();
+    settings.flush();
+    trace.flush(now);
+    power.deepSleep(now, local);
+    asleep = true;
+    halDeepSleep(seconds * 1000, BUTTON_UP);
+}
+
+// Opens and closes the active windows, and goes into deep sleep outside
+// them once nothing is left to finish
+void updateSchedule()
+{
+    static_assert(SCHEDULE_MIN_SLEEP > SCHEDULE_WAKE_LEAD, "a sleep has to outlast the wake lead");
+    uint32_t local;
+    if (!SCHEDULE_ENABLED || !halLocalTime(local))
+    {
+        return;
+    }
+
+    bool active = schedule.active(local);
+    if (active != inWindow)
+    {
+        inWindow = active;
+        lastJiggle = now;  // A full interval from the window opening
+        Serial.printf("schedule: window %s\n", active ? "opened" : "closed");
+    }
+    if (holdAwake && (int32_t)(now - awakeUntil) >= 0)
+    {
+        holdAwake = false;
+    }
+
+    // The clock counts whole seconds, an early check just comes back again
+    uint32_t until = schedule.untilChange(local);
+    uint32_t check = min(until, (uint32_t)SCHEDULE_CHECK_INTERVAL) * 1000;
+    if (holdAwake)
+    {
+        check = min(check, awakeUntil - now);
+    }
+    scheduler.arm(EVENT_SCHEDULE, now + check);
 
-        if (fullRedraw)
+    // A jiggle in progress still has to bring the cursor back
+    if (inWindow || holdAwake || until < SCHEDULE_MIN_SLEEP || jiggle.active())
+    {
+        return;
+    }
+    sleepUntilWindow(until == SCHEDULE_NEVER ? SCHEDULE_CHECK_INTERVAL : until - SCHEDULE_WAKE_LEAD, local);
+}
+
+void updateLink()
+{
+    // Short interval while a jiggle runs or is about to, long interval with
+    // slave latency otherwise
+    bool fast = jiggle.active() || (running && inWindow && nextJiggleDiff <= BLE_FAST_LEAD);
+    if (fast == linkFast)
+    {
+        return;
+    }
+
+    if (fast)
+    {
+        bleMouse.requestConnParams(BLE_FAST_INTERVAL_MIN, BLE_FAST_INTERVAL_MAX, BLE_FAST_LATENCY, BLE_TIMEOUT);
+    }
+    else
+    {
+        bleMouse.requestConnParams(BLE_IDLE_INTERVAL_MIN, BLE_IDLE_INTERVAL_MAX, BLE_IDLE_LATENCY, BLE_TIMEOUT);
+    }
+    linkFast = fast;
+}
+
+// Feeds the last RSSI readings and any failed notifications to the TX
+// power loop and asks for new readings. Failures are not counted per host,
+// one adds margin for all of them.
+void sampleLink()
+{
+    bool failed = bleMouse.reportsFailed != linkFailed;
+    linkFailed = bleMouse.reportsFailed;
+
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        if (!(hosts & (1 << host)))
         {
-            // Full screen redraw - clear everything
-            display.fillScreen(TFT_BLACK);
+            continue;
+        }
 
-            // Draw status
-            display.setCursor(5, 5);
-            if (connected)
+        int8_t power = linkControl.update(host, bleMouse.rssi(host), failed);
+        if (power != bleMouse.txPower(host))
+        {
+            bleMouse.setTxPower(host, power);
+        }
+
+        uint8_t bit = 1 << host;
+        if (linkControl.weak(host) != ((weakHosts & bit) != 0))
+        {
+            weakHosts ^= bit;
+            if (weakHosts & bit)
             {
-                if (running)
-                {
-                    display.setTextColor(TFT_GREEN);
-                    display.print("Jiggle");
-                }
-                else
-                {
-                    display.setTextColor(TFT_YELLOW);
-                    display.print("Paused");
-                }
+                Serial.printf("BLE host %u weak link, %d dBm at %+d dBm TX\n", host + 1, linkControl.rssi(host), power);
             }
             else
             {
-                display.setTextColor(TFT_RED);
-                display.print("Wait");
+                Serial.printf("BLE host %u link recovered, %d dBm\n", host + 1, linkControl.rssi(host));
             }
+        }
+    }
+    bleMouse.readRssi();
+}
 
-            // Draw static labels and jiggle count (smaller text to fit on screen)
-            display.setTextSize(2);  // Back to size 2 for bottom line
-            display.setTextColor(TFT_WHITE);
-            display.setCursor(5, 105);
-            sprintf (s, "J:%-3lu I:%-3d C:%d", jiggleCount, intervals[current_interval], bluetoothChannelOffset);
-            display.print(s);
+// Heap and the closest each task came to overflowing its stack, for sizing
+// UI_TASK_STACK and MOUSE_TASK_STACK. The BTC/BTU tasks are Bluedroid's.
+void reportMemory()
+{
+    HalMemory memory;
+    if (!halMemory(memory))
+    {
+        return;
+    }
 
-            fullRedraw = false;
-            lastDisplayedSeconds = -1;  // Reset to force countdown update
-            lastProgress = -1;  // Reset to force progress bar update
+    static const char *const tasks[] = { "loopTask", "ui", "BTC_TASK", "BTU_TASK" };
+    char line[128];
+    int length = snprintf(line, sizeof(line), "reports %u", bleMouse.reportStackFree());
+    for (const char *task : tasks)
+    {
+        uint32_t free = halStackFree(task);
+        if (free != HAL_UNKNOWN && length < (int)sizeof(line))
+        {
+            length += snprintf(line + length, sizeof(line) - length, ", %s %u", task, free);
         }
+    }
+    Serial.printf("memory: heap %u free, %u min, %u largest; stack free %s\n",
+        memory.heapFree, memory.heapMinFree, memory.heapLargest, line);
+}
 
-        if (connected && running)
+void publish(bool force)
+{
+    UiState state = {};
+    state.jiggleCount = jiggleCount;
+    state.nextJiggleAt = lastJiggle + jiggle_interval;
+    state.jiggleInterval = jiggle_interval;
+    state.intervalSeconds = intervals[current_interval];
+    state.hosts = hosts;
+    state.flags = (connected ? UI_CONNECTED : 0) | (running ? UI_RUNNING : 0) | (inWindow ? 0 : UI_OFF_HOURS);
+
+    // The weakest link, the one that drops first
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        int8_t rssi = linkControl.rssi(host);
+        if ((hosts & (1 << host)) && rssi != 0 && (state.rssi == 0 || rssi < state.rssi))
+        {
+            state.rssi = rssi;
+            state.txPower = linkControl.power(host);
+        }
+    }
+
+    if (force || memcmp(&state, &published, sizeof(state)) != 0)
+    {
+        published = state;
+        uiState.write(state);
+        if (uiThreaded)
         {
-            // Update dynamic content only (no screen clear)
+            halUiWake();
+        }
+    }
+}
+
+// --> UI rendering
 
+// Connected host slots as in the footer, "1-3"
+void formatHosts(char *map, uint8_t hosts)
+{
+    for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+    {
+        map[host] = (hosts & (1 << host)) ? '1' + host : '-';
+    }
+    map[BLE_MAX_HOSTS] = '\0';
+}
+
+#if UI_DISPLAY
+
+void render(uint32_t now)
+{
+    PROBE_SCOPE(PROBE_RENDER);
+    bool connected = shown.flags & UI_CONNECTED;
+    bool running = shown.flags & UI_RUNNING;
+    bool offHours = shown.flags & UI_OFF_HOURS;
+    int32_t nextJiggleDiff = shown.nextJiggleAt - now;
+
+    // Status
+    if (offHours)
+    {
+        renderer.setStatus("Off", TFT_BLUE);
+    }
+    else if (connected)
+    {
+        if (running)
+        {
+            renderer.setStatus("Jiggle", TFT_GREEN);
+        }
+        else
+        {
+            renderer.setStatus("Paused", TFT_YELLOW);
+        }
+    }
+    else
+    {
+        renderer.setStatus("Wait", TFT_RED);
+    }
+
+    // Jiggle count, interval and connected hosts
+    char hostMap[BLE_MAX_HOSTS + 1];
+    formatHosts(hostMap, shown.hosts);
+    snprintf (s, sizeof(s), "J:%-3lu I:%-3d H:%s", (unsigned long)shown.jiggleCount, shown.intervalSeconds, hostMap);
+    renderer.setFooter(s);
+
+    // RSSI and TX power of the weakest link
+    if (connected && shown.rssi != 0)
+    {
+        uint16_t linkColor = shown.rssi > -70 ? TFT_GREEN : shown.rssi >= LINK_WEAK_RSSI ? TFT_YELLOW : TFT_RED;
+        snprintf (s, sizeof(s), "R%-3d T%+d", shown.rssi, shown.txPower);
+        renderer.setLink(s, linkColor);
+    }
+    else
+    {
+        renderer.setLink("", TFT_BLACK);
+    }
+
+    if (connected && running && !offHours)
+    {
+        if constexpr (UiPolicy::animations)
+        {
             // Rainbow Spinner - cycles through colors
             i_rainbow = (i_rainbow + 1) % numRainbowColors;
             i_animation = (i_animation + 1) % numAnimations;
-            display.setTextColor(rainbowColors[i_rainbow], TFT_BLACK);
-            display.setCursor(200, 5);
-            display.print(animation[i_animation]);
-            display.print(" ");  // Print space to clear any trailing pixels
-
-            // Countdown - only update when seconds change, with dynamic color
-            int currentSeconds = nextJiggleDiff / 1000;
-            if (currentSeconds != lastDisplayedSeconds)
-            {
-                // Calculate percentage of time remaining
-                int percentRemaining = (nextJiggleDiff * 100) / jiggle_interval;
-
-                // Choose color based on time remaining
-                uint16_t countdownColor;
-                if (percentRemaining > 50)
-                    countdownColor = TFT_GREEN;      // Plenty of time
-                else if (percentRemaining > 25)
-                    countdownColor = TFT_YELLOW;     // Getting close
-                else
-                    countdownColor = TFT_ORANGE;     // About to jiggle!
-
-                display.setTextColor(countdownColor, TFT_BLACK);  // Dynamic color with background
-                display.setCursor(5, 40);
-                sprintf (s, "%3ds", currentSeconds);  // Fixed width with space padding
-                display.print(s);
-                lastDisplayedSeconds = currentSeconds;
-            }
+            sprintf (s, "%c", animation[i_animation]);
+            renderer.setSpinner(s, rainbowColors[i_rainbow]);
+        }
+
+        // Countdown with dynamic color
+        int currentSeconds = nextJiggleDiff / 1000;
+        int percentRemaining = (nextJiggleDiff * 100) / shown.jiggleInterval;
+        uint16_t countdownColor;
+        if (percentRemaining > 50)
+            countdownColor = TFT_GREEN;      // Plenty of time
+        else if (percentRemaining > 25)
+            countdownColor = TFT_YELLOW;     // Getting close
+        else
+            countdownColor = TFT_ORANGE;     // About to jiggle!
 
-            // Progress bar - only update when progress changes, with color gradient
-            int barWidth = 220;
-            int barHeight = 12;
-            int barX = 10;
-            int barY = 75;
-            long elapsed = jiggle_interval - nextJiggleDiff;
-            int progress = (elapsed * barWidth) / jiggle_interval;
-            progress = constrain(progress, 0, barWidth);
+        sprintf (s, "%3ds", currentSeconds);  // Fixed width with space padding
+        renderer.setCountdown(s, countdownColor);
 
-            if (progress != lastProgress)
+        if constexpr (UiPolicy::progressBar)
+        {
+            // Progress bar with color gradient
+            long elapsed = shown.jiggleInterval - nextJiggleDiff;
+            int progress = (elapsed * Renderer::barWidth) / shown.jiggleInterval;
+            int percentComplete = (elapsed * 100) / shown.jiggleInterval;
+            uint16_t barColor;
+            if (percentComplete < 50)
+                barColor = TFT_GREEN;      // First half - green
+            else if (percentComplete < 75)
+                barColor = TFT_YELLOW;     // Third quarter - yellow
+            else
+                barColor = TFT_ORANGE;     // Final quarter - orange (almost done!)
+
+            renderer.setProgress(progress, barColor);
+        }
+    }
+    else
+    {
+        renderer.setSpinner("", TFT_BLACK);
+        renderer.setCountdown("", TFT_BLACK);
+        renderer.hideProgress();
+    }
+
+    // Only the widgets that changed are pushed
+    renderer.push();
+    __atomic_fetch_add(&uiChargeUs, renderer.lastFrame().bytes / POWER_SPI_BYTES_PER_US, __ATOMIC_RELAXED);
+#if RENDER_STATS
+    Serial.printf("render: %u regions, %u px, %u bytes\n", renderer.lastFrame().regions, renderer.lastFrame().pixels, renderer.lastFrame().bytes);
+#endif
+
+    lastDisplayUpdate = now;
+}
+
+#else
+
+// Headless, one status line on serial for every new snapshot
+void render(uint32_t now)
+{
+    PROBE_SCOPE(PROBE_RENDER);
+    bool connected = shown.flags & UI_CONNECTED;
+    bool running = shown.flags & UI_RUNNING;
+    bool offHours = shown.flags & UI_OFF_HOURS;
+
+    char hostMap[BLE_MAX_HOSTS + 1];
+    formatHosts(hostMap, shown.hosts);
+    snprintf (s, sizeof(s), "%s", offHours ? "Off" : !connected ? "Wait" : running ? "Jiggle" : "Paused");
+    Serial.printf("status: %s J:%lu I:%d H:%s", s, (unsigned long)shown.jiggleCount, shown.intervalSeconds, hostMap);
+    if (connected && running && !offHours)
+    {
+        Serial.printf(" next in %ld s", (long)(int32_t)(shown.nextJiggleAt - now) / 1000);
+    }
+    if (connected && shown.rssi != 0)
+    {
+        Serial.printf(" R:%d T:%+d", shown.rssi, shown.txPower);
+    }
+    Serial.println();
+
+    lastDisplayUpdate = now;
+}
+
+#endif
+
+// Redraws on a new snapshot, and every DISPLAY_UPDATE_INTERVAL while the
+// countdown runs
+void uiRender(uint32_t now)
+{
+#if UI_DISPLAY
+    if (!displayReady)
+    {
+        displayBegin(now);
+        displayReady = true;
+    }
+    if (splashing && splash(now))
+    {
+        return;
+    }
+
+    // Nothing is drawn or sent over SPI while the panel sleeps. Back from
+    // sleep, the whole screen is drawn from the current snapshot at once.
+    bool awake = backlight.update(now);
+    uint32_t when;
+    if (backlight.deadline(when))
+    {
+        uiWakeAt(when);
+    }
+    if (!awake)
+    {
+        return;
+    }
+    if (backlight.takeRedraw())
+    {
+        renderer.invalidate();
+        shownVersion = UINT32_MAX;
+    }
+#endif
+
+    uint32_t version = uiState.read(shown);
+    bool ticking = UiPolicy::display && (shown.flags & UI_CONNECTED) && (shown.flags & UI_RUNNING) && !(shown.flags & UI_OFF_HOURS);
+
+    if (version != shownVersion || (ticking && (int32_t)(now - lastDisplayUpdate) >= DISPLAY_UPDATE_INTERVAL))
+    {
+        shownVersion = version;
+        render(now);
+    }
+
+    if (ticking)
+    {
+        uiWakeAt(lastDisplayUpdate + DISPLAY_UPDATE_INTERVAL);
+    }
+}
+
+// Display task body, on the core loop() and the HID report task do not use,
+// so SPI pushes never hold up a report
+void uiTask()
+{
+    uint32_t now = millis();
+    handleButtons(now);
+    uiRender(now);
+    __atomic_fetch_add(&uiChargeUs, POWER_WAKEUP_US, __ATOMIC_RELAXED);
+
+    uint32_t timeout = HAL_WAIT_FOREVER;
+    if (uiDeadlineArmed)
+    {
+        timeout = max((int32_t)(uiDeadline - millis()), (int32_t)0);
+    }
+    halUiWait(timeout);
+}
+
+void loop()
+{
+    // Sleep until a timer expires, a button changes or the connection changes
+    uint32_t events = scheduler.wait();
+    PROBE_SCOPE(PROBE_LOOP);
+    now = millis();
+    power.charge(POWER_WAKEUP_US + __atomic_exchange_n(&uiChargeUs, 0, __ATOMIC_RELAXED));
+
+    // Without a display task, button presses are handled in this same pass
+    if (!uiThreaded)
+    {
+        handleButtons(now);
+    }
+    handleCommands();
+    settings.update(now);
+
+    if (events & EVENT_BIT(EVENT_CONNECTION))
+    {
+        handleConnection();
+    }
+
+    if (events & EVENT_BIT(EVENT_SERIAL))
+    {
+        handleSerial();
+    }
+
+    if (events & EVENT_BIT(EVENT_RSSI))
+    {
+        sampleLink();
+    }
+
+    if (events & EVENT_BIT(EVENT_STATS))
+    {
+        uint32_t wakeups = scheduler.wakeups - lastWakeups;
+        Serial.printf("wakeups: %u in %u s\n", wakeups, (now - lastStats) / 1000);
+        lastWakeups = scheduler.wakeups;
+        lastStats = now;
+        scheduler.arm(EVENT_STATS, now + STATS_INTERVAL);
+        power.report(now);
+#if UI_DISPLAY
+        backlight.report();
+#endif
+        for (uint8_t host = 0; host < BLE_MAX_HOSTS; host++)
+        {
+            if (hosts & (1 << host))
             {
-                // Calculate percentage complete
-                int percentComplete = (elapsed * 100) / jiggle_interval;
-
-                // Choose bar color based on progress
-                uint16_t barColor;
-                if (percentComplete < 50)
-                    barColor = TFT_GREEN;      // First half - green
-                else if (percentComplete < 75)
-                    barColor = TFT_YELLOW;     // Third quarter - yellow
-                else
-                    barColor = TFT_ORANGE;     // Final quarter - orange (almost done!)
-
-                // Only redraw bar when progress changes
-                display.fillRect(barX, barY, barWidth, barHeight, TFT_BLACK);
-                display.drawRect(barX, barY, barWidth, barHeight, TFT_WHITE);
-                display.fillRect(barX, barY, progress, barHeight, barColor);
-                lastProgress = progress;
+                Serial.printf("link %u: interval %u.%02u ms, latency %u, timeout %u ms, last update took %u ms, rssi %d dBm, tx %+d dBm\n", host + 1,
+                    bleMouse.connInterval(host) * 125 / 100, bleMouse.connInterval(host) * 125 % 100,
+                    bleMouse.connLatency(host), bleMouse.connTimeout(host) * 10, bleMouse.connUpdateTime(host),
+                    linkControl.rssi(host), bleMouse.txPower(host));
             }
         }
+        Serial.printf("reports: %u sent, %u coalesced, %u dropped, %u failed, %u retried, %u lost\n",
+            bleMouse.reportsSent, bleMouse.reportsCoalesced, bleMouse.reportsDropped, bleMouse.reportsFailed,
+            bleMouse.reportsRetried, bleMouse.reportsLost);
+        Serial.printf("tx power: %u raised, %u lowered\n", linkControl.raises, linkControl.lowers);
+        Serial.printf("trace: %u records in %u bytes, %u overwritten\n", trace.records, trace.used(), trace.overwritten);
+        trace.save(now);
+        reportMemory();
+#if PROBES
+        probes.sendFrame(now);
+#endif
+    }
 
-        dirty = false;
-        lastDisplayUpdate = now;
+    updateSchedule();
+    if (asleep)
+    {
+        return;
     }
 
-    if (connected && running && nextJiggleDiff <= 0)
+    nextJiggleDiff = jiggle_interval - (now - lastJiggle);
+
+    if (connected && running && inWindow && nextJiggleDiff <= 0 && !jiggle.active())
     {
         // Add random timing variance (+/- 5 seconds) to make timing less predictable
-        int timeVariance = random(-JIGGLE_TIME_VARIANCE, JIGGLE_TIME_VARIANCE + 1);
+        int variance = tunables.get().timeVariance;
+        int timeVariance = random(-variance, variance + 1);
         lastJiggle = now - timeVariance;
-        moveMouse();
+        nextJiggleDiff = jiggle_interval - (now - lastJiggle);
+        {
+            PROBE_SCOPE(PROBE_JIGGLE);
+            jiggle.start(now, tunables.get().jiggle, jiggleStepSlack());
+            queueJiggle();
+        }
         jiggleCount++;
-        fullRedraw = true;  // Force redraw to update jiggle count
-        dirty = true;
     }
+    jiggle.update(now);
+
+    // Latched, a stale deadline would look unsettled again 24.8 days later
+    if (!linkSettled && (int32_t)(now - linkSettleAt) >= 0)
+    {
+        linkSettled = true;
+    }
+    if (connected && linkSettled)
+    {
+        updateLink();
+    }
+
+    trace.setState(now, hosts, running && inWindow, intervals[current_interval]);
+    trace.update();
+    publish(false);
+    if (!uiThreaded)
+    {
+        uiRender(now);
+        if (uiDeadlineArmed)
+        {
+            scheduler.arm(EVENT_UI, uiDeadline);
+        }
+        else
+        {
+            scheduler.disarm(EVENT_UI);
+        }
+    }
+
+    // Arm the timers for whatever comes next
+    if (connected && running && inWindow)
+    {
+        scheduler.arm(EVENT_JIGGLE, lastJiggle + jiggle_interval);
+    }
+    else
+    {
+        scheduler.disarm(EVENT_JIGGLE);
+    }
+
+    if (jiggle.active())
+    {
+        scheduler.arm(EVENT_JIGGLE_DONE, jiggle.due());
+    }
+
+    uint32_t settingsDue;
+    if (settings.due(settingsDue))
+    {
+        scheduler.arm(EVENT_SETTINGS, settingsDue);
+    }
+
+    if (!connected)
+    {
+        scheduler.disarm(EVENT_RSSI);
+    }
+    else if (events & EVENT_BIT(EVENT_RSSI))
+    {
+        scheduler.arm(EVENT_RSSI, now + LINK_RSSI_INTERVAL);
+    }
+
+    if (connected && !linkSettled)
+    {
+        scheduler.arm(EVENT_LINK, linkSettleAt);
+    }
+    else if (connected && running && inWindow && !linkFast)
+    {
+        scheduler.arm(EVENT_LINK, lastJiggle + jiggle_interval - BLE_FAST_LEAD);
+    }
+    else
+    {
+        scheduler.disarm(EVENT_LINK);
+    }
+
+    // Stay at full speed through a jiggle, save power while waiting for the next one
+    power.active(jiggle.active(), now);
 }
@@ -0,0 +1,126 @@
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+#include "power.h"
+
+static const char *stateNames[NUM_POWER_STATES] = { "active", "idle", "sleep", "deep sleep" };
+static const float stateCurrents[NUM_POWER_STATES] = { POWER_ACTIVE_MA, POWER_IDLE_MA, POWER_SLEEP_MA, POWER_DEEP_SLEEP_MA };
+
+// Microseconds per state, in RTC memory to survive deep sleep
+static RTC_DATA_ATTR uint64_t stateUs[NUM_POWER_STATES];
+static RTC_DATA_ATTR uint32_t sleptAt;  // Local clock time deep sleep began
+
+void Power::begin(uint32_t now, bool resume)
+{
+    static const uint8_t wakePins[] = { BUTTON_UP, BUTTON_DOWN };
+
+    uint32_t local;
+    if (!resume)
+    {
+        memset(stateUs, 0, sizeof(stateUs));
+    }
+    else if (halLocalTime(local))
+    {
+        stateUs[POWER_DEEP_SLEEP] += (uint64_t)(local - sleptAt) * 1000000;
+    }
+    state = POWER_ACTIVE;
+    since = now;
+
+#if POWER_SAVE
+    lightSleep = halEnableLightSleep(wakePins, sizeof(wakePins));
+#endif
+}
+
+void Power::charge(uint32_t us)
+{
+    stateUs[POWER_ACTIVE] += us;
+}
+
+void Power::deepSleep(uint32_t now, uint32_t local)
+{
+    enter(POWER_DEEP_SLEEP, now);
+    sleptAt = local;
+}
+
+void Power::enter(uint8_t next, uint32_t now)
+{
+    stateUs[state] += (uint64_t)(now - since) * 1000;
+    since = now;
+
+    if (next == state)
+    {
+        return;
+    }
+    state = next;
+
+#if POWER_SAVE
+    // With light sleep the power management driver scales the clock itself
+    if (!lightSleep)
+    {
+        halSetCpuMhz(state == POWER_ACTIVE ? POWER_ACTIVE_MHZ : POWER_IDLE_MHZ);
+    }
+#endif
+}
+
+void Power::active(bool on, uint32_t now)
+{
+    enter(on ? POWER_ACTIVE : (lightSleep ? POWER_SLEEP : POWER_IDLE), now);
+}
+
+uint64_t Power::stateTime(uint8_t state, uint32_t now) const
+{
+    uint64_t us = stateUs[state];
+    if (state == this->state)
+    {
+        us += (uint64_t)(now - since) * 1000;
+    }
+    return us;
+}
+
+// Average current over the time counted, the display only draws while awake.
+// Its own states are counted from boot, not across deep sleeps.
+float Power::average(uint32_t now, bool withDeepSleep) const
+{
+    uint64_t total = 0;
+    uint64_t awake = 0;
+    float mAus = 0;
+
+    for (uint8_t i = 0; i < NUM_POWER_STATES; i++)
+    {
+        uint64_t us = stateTime(i, now);
+        if (i == POWER_DEEP_SLEEP && !withDeepSleep)
+        {
+            continue;
+        }
+        total += us;
+        awake += i == POWER_DEEP_SLEEP ? 0 : us;
+        mAus += us * stateCurrents[i];
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    return (mAus + awake * (displayMa ? displayMa() : 0.0f)) / total;
+}
+
+float Power::mAhPerDay(uint32_t now) const
+{
+    return average(now, true) * 24;
+}
+
+float Power::mAhPerDayAwake(uint32_t now) const
+{
+    return average(now, false) * 24;
+}
+
+void Power::report(uint32_t now) const
+{
+    Serial.printf("power:");
+    for (uint8_t i = 0; i < NUM_POWER_STATES; i++)
+    {
+        Serial.printf(" %s %llu ms", stateNames[i], (unsigned long long)(stateTime(i, now) / 1000));
+    }
+    Serial.printf(", ~%.0f mAh/day\n", mAhPerDay(now));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+enum PowerState {
+    POWER_ACTIVE,  // Full clock, jiggle in progress or drawing
+    POWER_IDLE,    // Reduced clock, waiting for the next event
+    POWER_SLEEP,   // Automatic light sleep between events, BLE in modem sleep
+    POWER_DEEP_SLEEP,  // Outside the active windows, everything but the RTC off
+    NUM_POWER_STATES
+};
+
+// Switches the CPU between full speed and power save, and keeps an energy
+// estimate from the time spent in each state and the currents in config.h.
+// The times are kept in RTC memory, so they add up across deep sleeps.
+class Power
+{
+public:
+    // Resuming from deep sleep keeps the times and adds the time asleep
+    void begin(uint32_t now, bool resume);
+
+    // Full speed while something is happening, power save otherwise
+    void active(bool on, uint32_t now);
+
+    // Work too short to time with millis(), charged at full speed
+    void charge(uint32_t us);
+
+    // Going into deep sleep, local is the clock time now
+    void deepSleep(uint32_t now, uint32_t local);
+
+    uint64_t stateTime(uint8_t state, uint32_t now) const;
+    float mAhPerDay(uint32_t now) const;
+    float mAhPerDayAwake(uint32_t now) const;  // As if it never went into deep sleep
+    void report(uint32_t now) const;
+
+    bool lightSleep = false;  // Automatic light sleep is available
+    float (*displayMa)(void) = nullptr;  // Average panel and backlight current while awake, none headless
+
+private:
+    uint8_t state = POWER_ACTIVE;
+    uint32_t since = 0;
+
+    void enter(uint8_t next, uint32_t now);
+    float average(uint32_t now, bool withDeepSleep) const;
+};
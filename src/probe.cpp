@@ -0,0 +1,64 @@
+#include "probe.h"
+
+#if PROBES
+
+#include <Arduino.h>
+#include "crc32.h"
+
+Probes probes;
+
+void Probes::record(uint8_t probe, uint32_t us)
+{
+    ProbeHistogram &histogram = histograms[probe];
+
+    uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    histogram.buckets[min(bucket, (uint8_t)(PROBE_BUCKETS - 1))]++;
+    histogram.count++;
+    if (us > histogram.maxUs)
+    {
+        histogram.maxUs = us;
+    }
+
+    if (us >= PROBE_SLOW_US)
+    {
+        uint32_t slot = __atomic_fetch_add(&slowTotal, 1, __ATOMIC_RELAXED) % PROBE_SLOW_EVENTS;
+        slow[slot] = { (uint32_t)millis(), us, probe, {} };
+    }
+}
+
+// Writes to serial and keeps the CRC going
+static uint32_t emit(const void *data, size_t length, uint32_t crc)
+{
+    Serial.write((const uint8_t *)data, length);
+    return crc32((const uint8_t *)data, length, crc);
+}
+
+void Probes::sendFrame(uint32_t now)
+{
+    // Only the newest records if more came in than the ring holds
+    uint32_t total = __atomic_load_n(&slowTotal, __ATOMIC_RELAXED);
+    uint32_t count = min(total - slowSent, (uint32_t)PROBE_SLOW_EVENTS);
+
+    ProbeFrameHeader header = {};
+    header.magic[0] = PROBE_FRAME_MAGIC0;
+    header.magic[1] = PROBE_FRAME_MAGIC1;
+    header.version = PROBE_FRAME_VERSION;
+    header.probes = NUM_PROBES;
+    header.buckets = PROBE_BUCKETS;
+    header.slowEvents = count;
+    header.time = now;
+    header.slowTotal = total;
+
+    Serial.write(header.magic, sizeof(header.magic));
+    uint32_t crc = emit(&header.version, sizeof(header) - sizeof(header.magic), 0);
+    crc = emit(histograms, sizeof(histograms), crc);
+    for (uint32_t i = total - count; i != total; i++)
+    {
+        crc = emit(&slow[i % PROBE_SLOW_EVENTS], sizeof(ProbeSlowEvent), crc);
+    }
+    Serial.write((const uint8_t *)&crc, sizeof(crc));
+
+    slowSent = total;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+#include "hal.h"
+
+// Latency probes on the hot paths. Each probe keeps a log2 histogram of its
+// durations in microseconds, runs over PROBE_SLOW_US are also kept as slow
+// records. sendFrame() writes everything as one binary frame to serial, for
+// tools/probes.py to decode. With PROBES 0 none of this is compiled in.
+enum ProbeId {
+    PROBE_LOOP,    // loop() pass, from wakeup to sleep
+    PROBE_RENDER,  // Building and pushing one display frame
+    PROBE_JIGGLE,  // Planning a path and queueing its reports
+    PROBE_NOTIFY,  // One HID notification, timed by BleMouse
+    NUM_PROBES
+};
+
+// Bucket 0 is under 1 us, bucket n from 2^(n-1) us, the last one open ended
+#define PROBE_BUCKETS 16
+
+#if PROBES
+
+#define PROBE_FRAME_MAGIC0 0xA5       // Never part of the text log
+#define PROBE_FRAME_MAGIC1 0x5A
+#define PROBE_FRAME_VERSION 1
+
+// Frame on the wire, little endian: header, NUM_PROBES histograms, slow
+// records, then a CRC-32 of everything after the magic bytes
+struct ProbeFrameHeader {
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t probes;
+    uint8_t buckets;
+    uint8_t slowEvents;  // Records in this frame
+    uint16_t reserved;
+    uint32_t time;       // millis()
+    uint32_t slowTotal;  // Slow records since boot, including ones never sent
+};
+
+struct ProbeHistogram {
+    uint32_t count;  // Since boot
+    uint32_t maxUs;
+    uint32_t buckets[PROBE_BUCKETS];
+};
+
+struct ProbeSlowEvent {
+    uint32_t time;
+    uint32_t us;
+    uint8_t probe;
+    uint8_t reserved[3];
+};
+
+class Probes
+{
+public:
+    // Each probe has one writer at a time, the slow records may come from
+    // several tasks and are best effort
+    void record(uint8_t probe, uint32_t us);
+    void sendFrame(uint32_t now);
+
+private:
+    ProbeHistogram histograms[NUM_PROBES] = {};
+    ProbeSlowEvent slow[PROBE_SLOW_EVENTS] = {};
+    uint32_t slowTotal = 0;
+    uint32_t slowSent = 0;
+};
+
+extern Probes probes;
+
+// Times the rest of the enclosing scope
+class ProbeScope
+{
+public:
+    explicit ProbeScope(uint8_t probe) : probe(probe), started(halTimerUs()) {}
+    ~ProbeScope() { probes.record(probe, halTimerUs() - started); }
+
+private:
+    uint8_t probe;
+    uint32_t started;
+};
+
+#define PROBE_CONCAT2(a, b) a##b
+#define PROBE_CONCAT(a, b) PROBE_CONCAT2(a, b)
+#define PROBE_SCOPE(probe) ProbeScope PROBE_CONCAT(probeScope, __LINE__)(probe)
+
+#else
+
+#define PROBE_SCOPE(probe) do {} while (0)
+
+#endif
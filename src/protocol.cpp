@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include "crc32.h"
+#include "protocol.h"
+
+enum ParserState : uint8_t {
+    WAIT_MAGIC0,
+    WAIT_MAGIC1,
+    WAIT_OP,
+    WAIT_SEQ,
+    WAIT_LENGTH,
+    WAIT_PAYLOAD,
+    WAIT_CRC,
+    SKIP_FRAME
+};
+
+uint8_t ConfigParser::feed(uint8_t c, uint32_t now)
+{
+    if (state != WAIT_MAGIC0 && now - lastByte > CONFIG_FRAME_TIMEOUT)
+    {
+        state = WAIT_MAGIC0;
+        timeouts++;
+    }
+    lastByte = now;
+
+    switch (state)
+    {
+    case WAIT_MAGIC0:
+        if (c != CONFIG_FRAME_MAGIC0)
+        {
+            return CONFIG_PARSE_TEXT;
+        }
+        state = WAIT_MAGIC1;
+        return CONFIG_PARSE_MORE;
+
+    case WAIT_MAGIC1:
+        // A lone magic byte is dropped, what follows is text again
+        if (c == CONFIG_FRAME_MAGIC0)
+        {
+            return CONFIG_PARSE_MORE;
+        }
+        if (c != CONFIG_FRAME_MAGIC1)
+        {
+            state = WAIT_MAGIC0;
+            return CONFIG_PARSE_TEXT;
+        }
+        state = WAIT_OP;
+        crc = 0;
+        return CONFIG_PARSE_MORE;
+
+    case WAIT_OP:
+        current.op = c;
+        state = WAIT_SEQ;
+        break;
+
+    case WAIT_SEQ:
+        current.seq = c;
+        state = WAIT_LENGTH;
+        break;
+
+    case WAIT_LENGTH:
+        current.length = c;
+        received = 0;
+        expected = 0;
+        if (c > CONFIG_PAYLOAD_MAX)
+        {
+            // Its payload could hold anything, text commands included
+            state = SKIP_FRAME;
+            skipping = c + 4;
+            return CONFIG_PARSE_MORE;
+        }
+        state = c > 0 ? WAIT_PAYLOAD : WAIT_CRC;
+        break;
+
+    case WAIT_PAYLOAD:
+        current.payload[received++] = c;
+        if (received == current.length)
+        {
+            received = 0;
+            state = WAIT_CRC;
+        }
+        break;
+
+    case WAIT_CRC:
+        expected |= (uint32_t)c << (8 * received++);
+        if (received < 4)
+        {
+            return CONFIG_PARSE_MORE;
+        }
+        state = WAIT_MAGIC0;
+        if (expected != crc)
+        {
+            errors++;
+            return CONFIG_PARSE_ERROR;
+        }
+        frames++;
+        return CONFIG_PARSE_FRAME;
+
+    case SKIP_FRAME:
+        if (--skipping > 0)
+        {
+            return CONFIG_PARSE_MORE;
+        }
+        state = WAIT_MAGIC0;
+        errors++;
+        return CONFIG_PARSE_ERROR;
+    }
+
+    crc = crc32(&c, 1, crc);
+    return CONFIG_PARSE_MORE;
+}
+
+void sendConfigFrame(uint8_t op, uint8_t seq, const uint8_t *payload, uint8_t length)
+{
+    const uint8_t header[] = { CONFIG_FRAME_MAGIC0, CONFIG_FRAME_MAGIC1, op, seq, length };
+    uint32_t crc = crc32(header + 2, sizeof(header) - 2);
+    crc = crc32(payload, length, crc);
+
+    Serial.write(header, sizeof(header));
+    Serial.write(payload, length);
+    Serial.write((const uint8_t *)&crc, sizeof(crc));
+}
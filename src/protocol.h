@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// Binary command frames on serial, for tools/config.py. Both ways, little
+// endian:
+//
+//   A5 43 | op | seq | length | payload (length bytes) | CRC-32 of op..payload
+//
+// A reply has op | CONFIG_REPLY and the seq of the request, its payload
+// starts with a status (TUNABLES_OK... from tunables.h, or CONFIG_BAD_*).
+// The magic byte never occurs in the text commands, bytes outside a frame
+// go to the line handler as before.
+
+#define CONFIG_FRAME_MAGIC0 0xA5       // Never part of the text log
+#define CONFIG_FRAME_MAGIC1 0x43
+#define CONFIG_PAYLOAD_MAX 80          // Fits the tunables blob and a status byte
+
+// Requests
+#define CONFIG_GET 0x01       // id -> status, id, value
+#define CONFIG_SET 0x02       // id, value -> status
+#define CONFIG_EXPORT 0x03    // -> status, blob
+#define CONFIG_IMPORT 0x04    // blob -> status
+#define CONFIG_DEFAULTS 0x05  // -> status
+#define CONFIG_RESTART 0x06   // -> status, then the board restarts
+#define CONFIG_REPLY 0x80
+
+// Statuses of frames that did not get as far as the tunables
+#define CONFIG_BAD_CRC 0x80
+#define CONFIG_BAD_OP 0x81
+
+struct ConfigFrame {
+    uint8_t op;
+    uint8_t seq;
+    uint8_t length;
+    uint8_t payload[CONFIG_PAYLOAD_MAX];
+};
+
+enum ConfigParse : uint8_t {
+    CONFIG_PARSE_TEXT,   // Not part of a frame, the byte is the caller's
+    CONFIG_PARSE_MORE,   // Taken, a frame is under way
+    CONFIG_PARSE_FRAME,  // Taken, frame() is a complete and intact frame
+    CONFIG_PARSE_ERROR   // Taken, frame() failed its CRC or was too long, op and seq may be wrong
+};
+
+// Streaming parser, a byte at a time into a fixed buffer. A frame that goes
+// quiet for CONFIG_FRAME_TIMEOUT is dropped, so a host that gave up halfway
+// does not leave it waiting. The rest of a frame too long to take is skipped
+// as far as its length says, it is never taken for text.
+class ConfigParser
+{
+public:
+    uint8_t feed(uint8_t c, uint32_t now);
+    const ConfigFrame &frame() const { return current; }
+
+    uint32_t frames = 0;
+    uint32_t errors = 0;    // CRC or length
+    uint32_t timeouts = 0;
+
+private:
+    uint8_t state = 0;
+    uint8_t received = 0;   // Payload or CRC bytes so far
+    uint16_t skipping = 0;  // Payload and CRC bytes left of a frame too long to take
+    uint32_t crc = 0;       // Over what came in, CRC bytes excluded
+    uint32_t expected = 0;  // CRC bytes as they arrive
+    uint32_t lastByte = 0;
+    ConfigFrame current = {};
+};
+
+// Writes one frame to serial
+void sendConfigFrame(uint8_t op, uint8_t seq, const uint8_t *payload, uint8_t length);
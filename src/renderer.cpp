@@ -0,0 +1,149 @@
+#include "config.h"
+
+#if UI_DISPLAY
+
+#include <string.h>
+#include "renderer.h"
+#include "ui.h"
+
+void Renderer::begin()
+{
+    atlas.begin(display);
+    if constexpr (UiPolicy::progressBar)
+    {
+        barSprite.setColorDepth(16);
+        barSprite.createSprite(bar.w, bar.h);
+    }
+
+    // The only full-screen clear, everything after this is per widget
+    display.fillScreen(TFT_BLACK);
+    invalidate();
+}
+
+void Renderer::invalidate()
+{
+    // No character is '\0', every cell gets drawn again
+    memset(status.shown, 0, sizeof(status.shown));
+    memset(spinner.shown, 0, sizeof(spinner.shown));
+    memset(countdown.shown, 0, sizeof(countdown.shown));
+    memset(link.shown, 0, sizeof(link.shown));
+    memset(footer.shown, 0, sizeof(footer.shown));
+    bar.dirtyFrom = 0;
+    bar.dirtyTo = bar.w;
+}
+
+void Renderer::setText(TextWidget &widget, const char *text, uint16_t color)
+{
+    if (widget.color == color && strncmp(widget.text, text, TEXT_WIDGET_CHARS) == 0)
+    {
+        return;
+    }
+
+    strncpy(widget.text, text, TEXT_WIDGET_CHARS);
+    widget.text[TEXT_WIDGET_CHARS] = '\0';
+    widget.color = color;
+}
+
+void Renderer::setProgress(int16_t progress, uint16_t color)
+{
+    progress = constrain(progress, 0, bar.w);
+
+    if (!bar.visible || color != bar.color)
+    {
+        // Color change repaints the filled part, which may be the whole bar
+        bar.dirtyFrom = 0;
+        bar.dirtyTo = bar.w;
+    }
+    else if (progress != bar.progress)
+    {
+        // Only the columns between the old and the new fill level changed
+        bar.dirtyFrom = min(bar.dirtyFrom, min(progress, bar.progress));
+        bar.dirtyTo = max(bar.dirtyTo, max(progress, bar.progress));
+    }
+
+    bar.progress = progress;
+    bar.color = color;
+    bar.visible = true;
+}
+
+void Renderer::hideProgress()
+{
+    if (bar.visible)
+    {
+        bar.dirtyFrom = 0;
+        bar.dirtyTo = bar.w;
+        bar.visible = false;
+    }
+}
+
+void Renderer::count(int16_t w, int16_t h)
+{
+    frame.pixels += (uint32_t)w * h;
+    frame.bytes += (uint32_t)w * h * 2;  // 16-bit color
+    frame.regions++;
+}
+
+void Renderer::pushText(TextWidget &widget)
+{
+    int16_t w = GLYPH_WIDTH * widget.size;
+    int16_t h = GLYPH_HEIGHT * widget.size;
+    uint8_t cells = min(widget.w / w, TEXT_WIDGET_CHARS);
+    bool recolor = widget.color != widget.shownColor;
+    bool ended = false;
+
+    for (uint8_t i = 0; i < cells; i++)
+    {
+        // Past the end of the text the cells are blank
+        ended = ended || widget.text[i] == '\0';
+        char c = ended ? ' ' : widget.text[i];
+
+        // A blank cell looks the same in any color
+        if (c == widget.shown[i] && (c == ' ' || !recolor))
+        {
+            continue;
+        }
+
+        atlas.expand(c, widget.size, widget.color, TFT_BLACK, cell);
+        display.pushImage(widget.x + i * w, widget.y, w, h, cell);
+        count(w, h);
+        widget.shown[i] = c;
+    }
+    widget.shownColor = widget.color;
+}
+
+void Renderer::pushBar()
+{
+    if (!UiPolicy::progressBar || bar.dirtyFrom >= bar.dirtyTo)
+    {
+        return;
+    }
+
+    barSprite.fillSprite(TFT_BLACK);
+    if (bar.visible)
+    {
+        barSprite.drawRect(0, 0, bar.w, bar.h, TFT_WHITE);
+        barSprite.fillRect(0, 0, bar.progress, bar.h, bar.color);
+    }
+
+    int16_t w = bar.dirtyTo - bar.dirtyFrom;
+    barSprite.pushSprite(bar.x + bar.dirtyFrom, bar.y, bar.dirtyFrom, 0, w, bar.h);
+    count(w, bar.h);
+    bar.dirtyFrom = bar.w;
+    bar.dirtyTo = 0;
+}
+
+void Renderer::push()
+{
+    frame = {};
+
+    pushText(status);
+    pushText(spinner);
+    pushText(countdown);
+    pushText(link);
+    pushBar();
+    pushText(footer);
+
+    total += frame.bytes;
+}
+
+#endif
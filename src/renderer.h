@@ -0,0 +1,79 @@
+#pragma once
+
+#include <TFT_eSPI.h>
+#include "glyphs.h"
+
+#define TEXT_WIDGET_CHARS 20
+
+// Pixels and bytes sent over SPI by the last push()
+struct RenderStats {
+    uint32_t pixels;
+    uint32_t bytes;
+    uint16_t regions;
+};
+
+// One line of text on a row of font cells, size up to GLYPH_MAX_SIZE. Each
+// cell whose character or color changed is blitted from the glyph atlas on
+// its own, the rest stay as they are on the panel.
+struct TextWidget {
+    int16_t x, y, w, h;
+    uint8_t size;
+    char text[TEXT_WIDGET_CHARS + 1];
+    uint16_t color;
+    char shown[TEXT_WIDGET_CHARS + 1];  // Per cell, what the panel has
+    uint16_t shownColor;
+};
+
+struct BarWidget {
+    int16_t x, y, w, h;
+    int16_t progress;
+    uint16_t color;
+    bool visible;
+    int16_t dirtyFrom, dirtyTo;  // Column range to push, empty when dirtyFrom >= dirtyTo
+};
+
+// Retained-mode renderer: widgets keep their last state and push() only
+// sends the regions that changed since the previous frame.
+class Renderer
+{
+public:
+    Renderer(TFT_eSPI &display) : display(display), barSprite(&display) {}
+
+    void begin();
+
+    void setStatus(const char *text, uint16_t color) { setText(status, text, color); }
+    void setSpinner(const char *text, uint16_t color) { setText(spinner, text, color); }
+    void setCountdown(const char *text, uint16_t color) { setText(countdown, text, color); }
+    void setFooter(const char *text) { setText(footer, text, TFT_WHITE); }
+    void setLink(const char *text, uint16_t color) { setText(link, text, color); }
+    void setProgress(int16_t progress, uint16_t color);
+    void hideProgress();
+
+    // Push all dirty regions to the display and record what it cost
+    void push();
+    void invalidate();
+
+    const RenderStats &lastFrame() const { return frame; }
+    uint32_t totalBytes() const { return total; }
+
+    static const int16_t barWidth = 220;
+
+private:
+    TFT_eSPI &display;
+    GlyphAtlas atlas;
+    uint16_t cell[GLYPH_WIDTH * GLYPH_MAX_SIZE * GLYPH_HEIGHT * GLYPH_MAX_SIZE];  // One expanded glyph
+    TextWidget status = { 5, 5, 108, 24, 3 };
+    TextWidget spinner = { 200, 5, 36, 24, 3 };
+    TextWidget countdown = { 5, 40, 72, 24, 3 };
+    TextWidget link = { 125, 44, 110, 16, 2 };
+    TextWidget footer = { 5, 105, 230, 16, 2 };
+    BarWidget bar = { 10, 75, barWidth, 12 };
+    TFT_eSprite barSprite;  // Its pixels are the only heap the renderer takes
+    RenderStats frame = {};
+    uint32_t total = 0;
+
+    void setText(TextWidget &widget, const char *text, uint16_t color);
+    void pushText(TextWidget &widget);
+    void pushBar();
+    void count(int16_t w, int16_t h);
+};
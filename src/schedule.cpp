@@ -0,0 +1,72 @@
+#include "schedule.h"
+
+#define DAY_MINUTES 1440
+#define WEEK_MINUTES (7 * DAY_MINUTES)
+
+// Seconds since Monday 00:00, 1970-01-01 was a Thursday
+static uint32_t weekSecond(uint32_t local)
+{
+    return (local + 3 * 86400) % (WEEK_MINUTES * 60);
+}
+
+static uint16_t windowLength(const ScheduleWindow &window)
+{
+    return window.end > window.start ? window.end - window.start : window.end + DAY_MINUTES - window.start;
+}
+
+bool Schedule::activeAt(uint32_t minute) const
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const ScheduleWindow &window = windows[i];
+        for (uint8_t day = 0; day < 7; day++)
+        {
+            uint32_t start = day * DAY_MINUTES + window.start;
+            if ((window.days & (1 << day)) && (minute + WEEK_MINUTES - start) % WEEK_MINUTES < windowLength(window))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Schedule::active(uint32_t local) const
+{
+    return activeAt(weekSecond(local) / 60);
+}
+
+uint32_t Schedule::untilChange(uint32_t local) const
+{
+    // Windows start and end on whole minutes, only their edges can change
+    // anything. The nearest edge where the state flips wins.
+    uint32_t second = weekSecond(local);
+    uint32_t minute = second / 60;
+    bool now = activeAt(minute);
+    uint32_t nearest = SCHEDULE_NEVER;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const ScheduleWindow &window = windows[i];
+        for (uint8_t day = 0; day < 7; day++)
+        {
+            if (!(window.days & (1 << day)))
+            {
+                continue;
+            }
+
+            uint32_t start = day * DAY_MINUTES + window.start;
+            uint32_t edges[] = { start, (start + windowLength(window)) % WEEK_MINUTES };
+            for (uint32_t edge : edges)
+            {
+                uint32_t ahead = (edge + WEEK_MINUTES - minute) % WEEK_MINUTES;
+                if (ahead != 0 && ahead < nearest && activeAt(edge) != now)
+                {
+                    nearest = ahead;
+                }
+            }
+        }
+    }
+
+    return nearest == SCHEDULE_NEVER ? SCHEDULE_NEVER : nearest * 60 - second % 60;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// Days a window opens on, as a mask
+#define SCHEDULE_MONDAY 0x01
+#define SCHEDULE_TUESDAY 0x02
+#define SCHEDULE_WEDNESDAY 0x04
+#define SCHEDULE_THURSDAY 0x08
+#define SCHEDULE_FRIDAY 0x10
+#define SCHEDULE_SATURDAY 0x20
+#define SCHEDULE_SUNDAY 0x40
+#define SCHEDULE_WEEKDAYS 0x1F
+#define SCHEDULE_EVERY_DAY 0x7F
+
+#define SCHEDULE_NEVER UINT32_MAX
+
+struct ScheduleWindow {
+    uint8_t days;    // Days it opens on
+    uint16_t start;  // Minutes since local midnight
+    uint16_t end;    // Minutes since midnight, on the next day if not after start
+};
+
+// Weekly active windows, in local time as seconds since 1970 (a Thursday).
+// Windows may overlap and run past midnight.
+class Schedule
+{
+public:
+    Schedule(const ScheduleWindow *windows, uint8_t count) : windows(windows), count(count) {}
+
+    bool active(uint32_t local) const;
+
+    // Seconds until active() next changes, SCHEDULE_NEVER if it never does
+    uint32_t untilChange(uint32_t local) const;
+
+private:
+    const ScheduleWindow *windows;
+    uint8_t count;
+
+    bool activeAt(uint32_t minute) const;  // Minute of the week, from Monday 00:00
+};
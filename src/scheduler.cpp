@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include "hal.h"
+#include "scheduler.h"
+
+void Scheduler::arm(uint8_t event, uint32_t when)
+{
+    deadlines[event] = when;
+    armed |= EVENT_BIT(event);
+}
+
+void IRAM_ATTR Scheduler::post(uint8_t event)
+{
+    __atomic_fetch_or(&posted, EVENT_BIT(event), __ATOMIC_SEQ_CST);
+    halWake();
+}
+
+uint32_t Scheduler::wait()
+{
+    uint32_t now = millis();
+    uint32_t timeout = HAL_WAIT_FOREVER;
+
+    for (uint8_t event = 0; event < NUM_EVENTS; event++)
+    {
+        if (armed & EVENT_BIT(event))
+        {
+            // Signed difference keeps the comparison valid across millis() wraparound
+            int32_t left = deadlines[event] - now;
+            timeout = min(timeout, (uint32_t)max(left, (int32_t)0));
+        }
+    }
+
+    // A post() between the check and the wait is not lost, halWake() latches
+    if (posted == 0 && timeout > 0)
+    {
+        halWait(timeout);
+    }
+    wakeups++;
+
+    now = millis();
+    uint32_t fired = __atomic_exchange_n(&posted, 0, __ATOMIC_SEQ_CST);
+
+    for (uint8_t event = 0; event < NUM_EVENTS; event++)
+    {
+        if ((armed & EVENT_BIT(event)) && (int32_t)(now - deadlines[event]) >= 0)
+        {
+            fired |= EVENT_BIT(event);
+            armed &= ~EVENT_BIT(event);
+        }
+    }
+
+    return fired;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+// Things that wake loop(). Timers are one-shot and re-armed by loop(),
+// posted events come from the BLE task and the display task.
+enum SchedulerEvent {
+    EVENT_COMMAND,
+    EVENT_CONNECTION,
+    EVENT_UI,  // Display and button timers when the UI runs inside loop()
+    EVENT_JIGGLE,
+    EVENT_JIGGLE_DONE,
+    EVENT_LINK,
+    EVENT_SETTINGS,
+    EVENT_STATS,
+    EVENT_SERIAL,  // Bytes came in on serial
+    EVENT_SCHEDULE,  // An active window opens or closes
+    EVENT_RSSI,  // Link quality sample while connected
+    NUM_EVENTS
+};
+
+#define EVENT_BIT(event) (1u << (event))
+
+// One timer slot per event. wait() sleeps until the earliest armed deadline
+// or a post(), whichever comes first, so the CPU idles in between.
+class Scheduler
+{
+public:
+    void arm(uint8_t event, uint32_t when);
+    void disarm(uint8_t event) { armed &= ~EVENT_BIT(event); }
+
+    // Safe from interrupts and other tasks
+    void post(uint8_t event);
+
+    // Returns the bits of all events that fired
+    uint32_t wait();
+
+    uint32_t wakeups = 0;
+
+private:
+    uint32_t deadlines[NUM_EVENTS];
+    uint32_t armed = 0;
+    volatile uint32_t posted = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Single writer, any number of readers that never block the writer. A reader
+// copies the value and retries if the writer was in the middle of an update.
+// The copy is done word by word with relaxed atomics, so T must be plain
+// data and a whole number of 32-bit words.
+template <typename T>
+class Seqlock
+{
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "T must be a whole number of words");
+
+public:
+    void write(const T &value)
+    {
+        uint32_t words[WORDS];
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t s = sequence;  // Only the writer changes it
+        __atomic_store_n(&sequence, s + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (uint8_t i = 0; i < WORDS; i++)
+        {
+            __atomic_store_n(&data[i], words[i], __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&sequence, s + 2, __ATOMIC_RELEASE);
+    }
+
+    // Returns the version read, it changes with every write()
+    uint32_t read(T &value) const
+    {
+        uint32_t words[WORDS];
+        uint32_t before, after;
+
+        do
+        {
+            before = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+            for (uint8_t i = 0; i < WORDS; i++)
+            {
+                words[i] = __atomic_load_n(&data[i], __ATOMIC_RELAXED);
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+        } while ((before & 1) || before != after);
+
+        memcpy(&value, words, sizeof(T));
+        return before;
+    }
+
+private:
+    static const uint8_t WORDS = sizeof(T) / sizeof(uint32_t);
+    uint32_t data[WORDS] = {};
+    uint32_t sequence = 0;
+};
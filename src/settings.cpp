@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include <stddef.h>
+#include "config.h"
+#include "crc32.h"
+#include "settings.h"
+
+#define SETTINGS_KEY "settings"
+
+static uint32_t recordCrc(const SettingsRecord &record)
+{
+    return crc32((const uint8_t *)&record, offsetof(SettingsRecord, crc));
+}
+
+void Settings::begin()
+{
+    SettingsRecord record;
+    size_t length = 0;
+    if (preferences.isKey(SETTINGS_KEY))
+    {
+        length = preferences.getBytes(SETTINGS_KEY, &record, sizeof(record));
+    }
+
+    if (length == sizeof(record) && record.version == SETTINGS_VERSION && record.crc == recordCrc(record))
+    {
+        current = stored = record;
+        dirty = false;
+        return;
+    }
+
+    // No valid record: take over the keys older firmware wrote one by one,
+    // defaults where they are missing too
+    current.version = SETTINGS_VERSION;
+    current.interval = preferences.getShort("intv", DEFAULT_INTERVAL);
+    current.running = preferences.getBool("isrunning", true);
+    commit();
+
+    // The MAC offset of channel switching is gone, the identity is the MAC tunable
+    preferences.remove("intv");
+    preferences.remove("isrunning");
+    preferences.remove("macoffset");
+}
+
+void Settings::setInterval(uint8_t interval, uint32_t now)
+{
+    current.interval = interval;
+    changed(now);
+}
+
+void Settings::setRunning(bool running, uint32_t now)
+{
+    current.running = running;
+    changed(now);
+}
+
+void Settings::changed(uint32_t now)
+{
+    // Every change restarts the quiet period
+    dirty = true;
+    changedAt = now;
+}
+
+bool Settings::due(uint32_t &when) const
+{
+    when = changedAt + SETTINGS_COMMIT_DELAY;
+    return dirty;
+}
+
+void Settings::update(uint32_t now)
+{
+    // Signed difference keeps the comparison valid across millis() wraparound
+    if (dirty && (int32_t)(now - changedAt) >= SETTINGS_COMMIT_DELAY)
+    {
+        commit();
+    }
+}
+
+void Settings::flush()
+{
+    if (dirty)
+    {
+        commit();
+    }
+}
+
+void Settings::commit()
+{
+    dirty = false;
+    current.crc = recordCrc(current);
+
+    // Pressing a button back and forth ends where it started, nothing to write
+    if (memcmp(&current, &stored, sizeof(current)) == 0)
+    {
+        return;
+    }
+
+    if (preferences.putBytes(SETTINGS_KEY, &current, sizeof(current)) == sizeof(current))
+    {
+        stored = current;
+        commits++;
+    }
+}
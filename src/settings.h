@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <Preferences.h>
+
+// Everything that survives a reboot, stored as one NVS blob. The CRC covers
+// the fields before it, a record that fails the check is ignored.
+struct SettingsRecord {
+    uint8_t version;
+    uint8_t interval;   // Index into INTERVAL_LIST
+    uint8_t running;
+    uint8_t reserved;   // Was the channel's MAC offset
+    uint32_t crc;
+};
+
+#define SETTINGS_VERSION 1
+
+// Settings live in RAM. Changes are written back as a single record once
+// they have been left alone for SETTINGS_COMMIT_DELAY, so cycling through
+// intervals costs one flash write instead of one per press.
+class Settings
+{
+public:
+    Settings(Preferences &preferences) : preferences(preferences) {}
+
+    // Loads the record, or migrates the keys older firmware wrote one by one
+    void begin();
+
+    uint8_t interval() const { return current.interval; }
+    bool running() const { return current.running; }
+    void setInterval(uint8_t interval, uint32_t now);
+    void setRunning(bool running, uint32_t now);
+
+    // When update() has something to write, false if nothing is pending
+    bool due(uint32_t &when) const;
+    void update(uint32_t now);
+
+    // Write now, before a planned restart
+    void flush();
+
+    uint32_t commits = 0;
+
+private:
+    Preferences &preferences;
+    SettingsRecord current = {};
+    SettingsRecord stored = {};
+    bool dirty = false;
+    uint32_t changedAt = 0;
+
+    void changed(uint32_t now);
+    void commit();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+// Lock-free single producer / single consumer ring. The producer may be an
+// interrupt or a task on the other core, the consumer is one task. Holds
+// SIZE - 1 entries, SIZE must be a power of two.
+template <typename T, uint8_t SIZE>
+class SpscQueue
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+public:
+    // Always inlined, so it lands in IRAM along with the interrupt handler calling it
+    inline __attribute__((always_inline)) bool push(const T &entry)
+    {
+        uint8_t h = head;
+        uint8_t next = (h + 1) & (SIZE - 1);
+
+        if (next == __atomic_load_n(&tail, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&overflow, true, __ATOMIC_RELAXED);
+            return false;
+        }
+
+        entries[h] = entry;
+        __atomic_store_n(&head, next, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool pop(T &entry)
+    {
+        uint8_t t = tail;
+
+        if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+        {
+            return false;
+        }
+
+        entry = entries[t];
+        __atomic_store_n(&tail, (uint8_t)((t + 1) & (SIZE - 1)), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Set when an entry was dropped, the consumer then has to catch up some other way
+    bool overflowed() { return __atomic_exchange_n(&overflow, false, __ATOMIC_ACQUIRE); }
+
+private:
+    T entries[SIZE];
+    uint8_t head = 0;  // Written by the producer only
+    uint8_t tail = 0;  // Written by the consumer only
+    bool overflow = false;
+};
@@ -0,0 +1,277 @@
+#include <Arduino.h>
+#include <algorithm>
+#include "crc32.h"
+#include "hal.h"
+#include "trace.h"
+
+#define TRACE_PARTITION "trace"
+
+Trace trace;
+
+void Trace::update()
+{
+    Entry entry;
+    while (queue.pop(entry))
+    {
+        const MouseReport &report = entry.report;
+        const int16_t fields[] = { report.buttons, report.x, report.y, report.wheel, report.hWheel };
+        uint8_t payload[2 * 5];
+        uint8_t flags = 0;
+        uint8_t length = 0;
+        for (int16_t field : fields)
+        {
+            if (field < -128 || field > 127)
+            {
+                flags |= TRACE_WIDE;
+            }
+        }
+        for (uint8_t i = 0; i < 5; i++)
+        {
+            if (fields[i] != 0)
+            {
+                flags |= 1 << i;
+                payload[length++] = fields[i] & 0xFF;
+                if (flags & TRACE_WIDE)
+                {
+                    payload[length++] = fields[i] >> 8;
+                }
+            }
+        }
+        append(entry.time, flags, payload, length);
+    }
+}
+
+void Trace::setState(uint32_t now, uint8_t hosts, bool running, uint16_t intervalSeconds)
+{
+    if (booted && hosts == lastHosts && running == lastRunning && intervalSeconds == lastInterval)
+    {
+        return;
+    }
+
+    // Reports sent before the change go first
+    update();
+    lastHosts = hosts;
+    lastRunning = running;
+    lastInterval = intervalSeconds;
+    const uint8_t payload[] = { hosts, running, (uint8_t)intervalSeconds, (uint8_t)(intervalSeconds >> 8) };
+    append(now, TRACE_STATE, payload, sizeof(payload));
+}
+
+void Trace::append(uint32_t time, uint8_t flags, const uint8_t *payload, uint8_t length)
+{
+    uint8_t record[TRACE_RECORD_MAX];
+    uint8_t n = 0;
+
+    // The report task stamps before loop() does, a report can come out a
+    // millisecond behind a state record. Keep the deltas positive.
+    uint32_t value = time;
+    if (booted)
+    {
+        value = (int32_t)(time - lastTime) > 0 ? time - lastTime : 0;
+        time = lastTime + value;
+    }
+    else
+    {
+        flags |= TRACE_ABSOLUTE;
+        booted = true;
+    }
+
+    record[n++] = flags;
+    do
+    {
+        record[n++] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    memcpy(record + n, payload, length);
+    n += length;
+
+    while (TRACE_BUFFER_SIZE - size < n)
+    {
+        dropOldest();
+    }
+    for (uint8_t i = 0; i < n; i++)
+    {
+        ring[(tail + size + i) % TRACE_BUFFER_SIZE] = record[i];
+    }
+    size += n;
+    records++;
+    lastTime = time;
+    unsaved = true;
+}
+
+void Trace::dropOldest()
+{
+    TraceCursor cursor = first();
+    TraceRecord record;
+    next(cursor, record);
+    tail = (tail + cursor.offset) % TRACE_BUFFER_SIZE;
+    size -= cursor.offset;
+    baseTime = record.time;
+    if (record.flags & TRACE_STATE)
+    {
+        baseState = record;
+    }
+    records--;
+    overwritten++;
+}
+
+bool Trace::next(TraceCursor &cursor, TraceRecord &record) const
+{
+    if (cursor.offset >= size)
+    {
+        return false;
+    }
+
+    uint16_t offset = cursor.offset;
+    record = {};
+    record.flags = at(offset++);
+
+    uint32_t value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t byte = at(offset++);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+    }
+    record.time = record.flags & TRACE_ABSOLUTE ? value : cursor.time + value;
+
+    if (record.flags & TRACE_STATE)
+    {
+        record.hosts = at(offset);
+        record.running = at(offset + 1);
+        record.intervalSeconds = at(offset + 2) | at(offset + 3) << 8;
+        offset += 4;
+    }
+    else
+    {
+        int16_t fields[5] = {};
+        for (uint8_t i = 0; i < 5; i++)
+        {
+            if (record.flags & (1 << i))
+            {
+                fields[i] = (int8_t)at(offset++);
+                if (record.flags & TRACE_WIDE)
+                {
+                    fields[i] = (uint8_t)fields[i] | at(offset++) << 8;
+                }
+            }
+        }
+        record.report = { (uint8_t)fields[0], fields[1], fields[2], fields[3], fields[4], 0 };
+    }
+
+    cursor.offset = offset;
+    cursor.time = record.time;
+    return true;
+}
+
+void Trace::header(TraceFrameHeader &frame, uint32_t now)
+{
+    frame = {};
+    frame.magic[0] = TRACE_FRAME_MAGIC0;
+    frame.magic[1] = TRACE_FRAME_MAGIC1;
+    frame.version = TRACE_FRAME_VERSION;
+    frame.time = now;
+    frame.baseTime = baseTime;
+    frame.records = records;
+    frame.overwritten = overwritten;
+    frame.lost = __atomic_load_n(&lost, __ATOMIC_RELAXED);
+    frame.variance = variance;
+    frame.length = size;
+    frame.baseInterval = baseState.intervalSeconds;
+    frame.baseHosts = baseState.hosts;
+    frame.baseRunning = baseState.running;
+}
+
+// Writes to serial and keeps the CRC going
+static uint32_t emit(const void *data, size_t length, uint32_t crc)
+{
+    Serial.write((const uint8_t *)data, length);
+    return crc32((const uint8_t *)data, length, crc);
+}
+
+void Trace::sendFrame(uint32_t now)
+{
+    update();
+    TraceFrameHeader frame;
+    header(frame, now);
+
+    // The ring in at most two pieces, oldest first
+    uint16_t first = min(size, (uint16_t)(TRACE_BUFFER_SIZE - tail));
+    Serial.write(frame.magic, sizeof(frame.magic));
+    uint32_t crc = emit(&frame.version, sizeof(frame) - sizeof(frame.magic), 0);
+    crc = emit(ring + tail, first, crc);
+    crc = emit(ring, size - first, crc);
+    Serial.write((const uint8_t *)&crc, sizeof(crc));
+}
+
+// Rotates the ring so the oldest record is at the start, flash gets one piece
+void Trace::linearize()
+{
+    std::rotate(ring, ring + tail, ring + TRACE_BUFFER_SIZE);
+    tail = 0;
+}
+
+bool Trace::load()
+{
+    TraceFrameHeader frame;
+    if (!TRACE_PERSIST || !halStorageRead(TRACE_PARTITION, 0, &frame, sizeof(frame)) ||
+        frame.magic[0] != TRACE_FRAME_MAGIC0 || frame.magic[1] != TRACE_FRAME_MAGIC1 ||
+        frame.version != TRACE_FRAME_VERSION || frame.length > TRACE_BUFFER_SIZE)
+    {
+        return false;
+    }
+
+    uint32_t crc;
+    if (!halStorageRead(TRACE_PARTITION, sizeof(frame), ring, frame.length) ||
+        !halStorageRead(TRACE_PARTITION, sizeof(frame) + frame.length, &crc, sizeof(crc)) ||
+        crc != crc32(ring + 0, frame.length, crc32(&frame.version, sizeof(frame) - sizeof(frame.magic))))
+    {
+        size = 0;
+        return false;
+    }
+
+    tail = 0;
+    size = frame.length;
+    baseTime = frame.baseTime;
+    baseState.intervalSeconds = frame.baseInterval;
+    baseState.hosts = frame.baseHosts;
+    baseState.running = frame.baseRunning;
+    records = frame.records;
+    overwritten = frame.overwritten;
+
+    // Records from before the restart stay, the next one starts the clock over
+    booted = false;
+    unsaved = false;
+    return true;
+}
+
+bool Trace::save(uint32_t now)
+{
+    return now - lastSave >= TRACE_SAVE_INTERVAL && flush(now);
+}
+
+bool Trace::flush(uint32_t now)
+{
+    if (!TRACE_PERSIST || !unsaved)
+    {
+        return false;
+    }
+
+    update();
+    linearize();
+    TraceFrameHeader frame;
+    header(frame, now);
+    uint32_t crc = crc32(&frame.version, sizeof(frame) - sizeof(frame.magic));
+    crc = crc32(ring, size, crc);
+
+    // Erasing stalls both cores for tens of milliseconds, hence the long interval
+    lastSave = now;
+    unsaved = false;
+    return halStorageErase(TRACE_PARTITION, sizeof(frame) + size + sizeof(crc)) &&
+        halStorageWrite(TRACE_PARTITION, 0, &frame, sizeof(frame)) &&
+        halStorageWrite(TRACE_PARTITION, sizeof(frame), ring, size) &&
+        halStorageWrite(TRACE_PARTITION, sizeof(frame) + size, &crc, sizeof(crc));
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <BleMouse.h>
+#include "config.h"
+#include "spsc.h"
+
+// Record of every HID report that went out, for auditing what a host got.
+// The report task only pushes each sent report into a queue, loop() encodes
+// them into a byte ring where the oldest records give way to new ones.
+// sendFrame() writes the ring as one binary frame to serial, for
+// tools/trace.py to decode. With TRACE_PERSIST the same frame is kept in the
+// "trace" flash partition and survives a restart.
+
+#define TRACE_FRAME_MAGIC0 0xA5       // Never part of the text log
+#define TRACE_FRAME_MAGIC1 0x54
+#define TRACE_FRAME_VERSION 2  // 2 added TRACE_WIDE
+
+// First byte of a record. A report lists its non-zero fields, in this order,
+// one signed byte each, or two (little endian) with TRACE_WIDE. Then comes the time since the previous record in
+// milliseconds as a LEB128 varint, then the fields.
+#define TRACE_BUTTONS 0x01
+#define TRACE_X 0x02
+#define TRACE_Y 0x04
+#define TRACE_WHEEL 0x08
+#define TRACE_HWHEEL 0x10
+#define TRACE_FIELDS 0x1F
+#define TRACE_WIDE 0x20      // A field does not fit a byte, 16-bit report format
+#define TRACE_ABSOLUTE 0x40  // Time is millis() instead of a delta, first record after boot
+#define TRACE_STATE 0x80     // Not a report: hosts, running, interval seconds (16 bits) follow
+
+#define TRACE_RECORD_MAX 16  // Flags, a 5 byte varint and five wide fields
+
+static_assert(TRACE_BUFFER_SIZE <= 65535, "ring offsets are 16 bits");
+
+// Frame on the wire and in flash, little endian: header, the records oldest
+// first, then a CRC-32 of everything after the magic bytes
+struct TraceFrameHeader {
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t reserved;
+    uint32_t time;         // millis()
+    uint32_t baseTime;     // What the first record's delta counts from
+    uint32_t records;      // In this frame
+    uint32_t overwritten;  // Oldest records given up for newer ones
+    uint32_t lost;         // Reports the queue had no room for since boot
+    uint32_t variance;     // Jiggle time variance in effect
+    uint16_t length;       // Record bytes
+    uint16_t baseInterval; // State at baseTime, from the newest overwritten state
+    uint8_t baseHosts;     // record. All 0 if none was overwritten yet.
+    uint8_t baseRunning;
+    uint16_t reserved2;
+};
+
+struct TraceRecord {
+    uint32_t time;
+    uint8_t flags;
+    MouseReport report;  // Without delay, for a report
+    uint8_t hosts;       // For a state record
+    bool running;
+    uint16_t intervalSeconds;
+};
+
+// Where next() continues, start at first()
+struct TraceCursor {
+    uint16_t offset;
+    uint32_t time;
+};
+
+class Trace
+{
+public:
+    // From the report task, once the notification has gone out
+    void sent(uint32_t time, const MouseReport &report)
+    {
+        if (!queue.push({ time, report }))
+        {
+            __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    // The rest only from loop()
+    void update();
+    void setState(uint32_t now, uint8_t hosts, bool running, uint16_t intervalSeconds);
+    void sendFrame(uint32_t now);
+
+    // Flash partition, only with TRACE_PERSIST. save() writes at most once
+    // per TRACE_SAVE_INTERVAL and only when there is something new.
+    bool load();
+    bool save(uint32_t now);
+    bool flush(uint32_t now);  // Regardless of the interval, before deep sleep
+
+    TraceCursor first() const { return { 0, baseTime }; }
+    bool next(TraceCursor &cursor, TraceRecord &record) const;
+
+    uint32_t records = 0;  // In the ring
+    uint32_t variance = JIGGLE_TIME_VARIANCE;  // Goes into the header, set from the tunables
+    uint32_t overwritten = 0;
+    uint16_t used() const { return size; }
+
+private:
+    struct Entry {
+        uint32_t time;
+        MouseReport report;
+    };
+
+    SpscQueue<Entry, TRACE_QUEUE_SIZE> queue;
+    uint32_t lost = 0;
+
+    uint8_t ring[TRACE_BUFFER_SIZE];
+    uint16_t tail = 0;  // Oldest record
+    uint16_t size = 0;
+    uint32_t baseTime = 0;
+    TraceRecord baseState = {};
+    uint32_t lastTime = 0;
+    bool booted = false;  // A record since boot, later ones are deltas
+    uint8_t lastHosts = 0;
+    bool lastRunning = false;
+    uint16_t lastInterval = 0;
+    uint32_t lastSave = 0;
+    bool unsaved = false;
+
+    void append(uint32_t time, uint8_t flags, const uint8_t *payload, uint8_t length);
+    void dropOldest();
+    uint8_t at(uint16_t offset) const { return ring[(tail + offset) % TRACE_BUFFER_SIZE]; }
+    void header(TraceFrameHeader &frame, uint32_t now);
+    void linearize();
+};
+
+extern Trace trace;
@@ -0,0 +1,221 @@
+#include <Arduino.h>
+#include <stddef.h>
+#include "crc32.h"
+#include "tunables.h"
+
+#define TUNABLES_KEY "tunables"
+
+// Where each ID lives in the record
+struct TunableField {
+    uint8_t offset;
+    uint8_t size;
+};
+
+#define FIELD(member) { offsetof(TunablesRecord, member), sizeof(TunablesRecord::member) }
+
+static const TunableField fields[NUM_TUNABLES] = {
+    {},
+    FIELD(jiggle.minDistance),
+    FIELD(jiggle.maxDistance),
+    FIELD(jiggle.curve),
+    FIELD(jiggle.jitter),
+    FIELD(jiggle.wheelChance),
+    FIELD(jiggle.wheelMin),
+    FIELD(jiggle.wheelMax),
+    FIELD(jiggle.stepInterval),
+    FIELD(jiggle.wheelStepInterval),
+    FIELD(jiggle.wheelPeakPause),
+    FIELD(timeVariance),
+    FIELD(intervals),
+    FIELD(mac),
+    FIELD(name),
+};
+
+static uint32_t recordCrc(const TunablesRecord &record)
+{
+    return crc32((const uint8_t *)&record, offsetof(TunablesRecord, crc));
+}
+
+void Tunables::defaults(TunablesRecord &record)
+{
+    static const int intervals[] = INTERVAL_LIST;
+    static const uint8_t mac[] = BLE_MAC_BASE;
+    static_assert(sizeof(intervals) / sizeof(intervals[0]) <= INTERVAL_MAX_COUNT, "INTERVAL_LIST is too long");
+    static_assert(sizeof(BLE_DEVICE_NAME) <= BLE_NAME_MAX + 1, "BLE_DEVICE_NAME is too long");
+
+    memset(&record, 0, sizeof(record));
+    record.version = TUNABLES_VERSION;
+    record.jiggle = JIGGLE_PARAMS_DEFAULT;
+    record.timeVariance = JIGGLE_TIME_VARIANCE;
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++)
+    {
+        record.intervals[i] = intervals[i];
+    }
+    memcpy(record.mac, mac, sizeof(record.mac));
+    strcpy(record.name, BLE_DEVICE_NAME);
+    record.crc = recordCrc(record);
+}
+
+bool Tunables::valid(const TunablesRecord &record)
+{
+    const JiggleParams &jiggle = record.jiggle;
+    if (jiggle.minDistance < 1 || jiggle.minDistance > jiggle.maxDistance || jiggle.maxDistance > JIGGLE_DISTANCE_LIMIT ||
+        jiggle.curve > 100 || jiggle.jitter > 100 || jiggle.wheelChance > 100 ||
+        jiggle.wheelMin < 1 || jiggle.wheelMin > jiggle.wheelMax || jiggle.wheelMax > WHEEL_MAX_SCROLL ||
+        jiggle.stepInterval < 10 || jiggle.stepInterval > 1000 || jiggle.wheelStepInterval < 10 ||
+        jiggle.wheelStepInterval > 2000 || jiggle.wheelPeakPause > 5000 || jiggle.reserved != 0 || record.reserved != 0)
+    {
+        return false;
+    }
+
+    // At least one interval, the ones in use first, and the variance has to
+    // leave a gap before every jiggle
+    uint8_t count = 0;
+    while (count < INTERVAL_MAX_COUNT && record.intervals[count] != 0)
+    {
+        if (record.intervals[count] < INTERVAL_MIN || record.intervals[count] > INTERVAL_MAX ||
+            record.timeVariance >= record.intervals[count] * 500u)
+        {
+            return false;
+        }
+        count++;
+    }
+    for (uint8_t i = count; i < INTERVAL_MAX_COUNT; i++)
+    {
+        if (record.intervals[i] != 0)
+        {
+            return false;
+        }
+    }
+    if (count == 0)
+    {
+        return false;
+    }
+
+    // A unicast address, and a printable name
+    if (record.mac[0] & 0x01)
+    {
+        return false;
+    }
+    size_t length = strnlen(record.name, sizeof(record.name));
+    if (length == 0 || length == sizeof(record.name))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(record.name); i++)
+    {
+        char c = record.name[i];
+        if (i < length ? (c < ' ' || c > '~') : c != '\0')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Tunables::begin()
+{
+    TunablesRecord record;
+    size_t length = 0;
+    if (preferences.isKey(TUNABLES_KEY))
+    {
+        length = preferences.getBytes(TUNABLES_KEY, &record, sizeof(record));
+    }
+
+    // Nothing stored is the usual case, the defaults are not written
+    if (length == sizeof(record) && record.version == TUNABLES_VERSION && record.crc == recordCrc(record) && valid(record))
+    {
+        current = record;
+    }
+    else
+    {
+        defaults(current);
+    }
+    booted = current;
+}
+
+uint8_t Tunables::intervalCount() const
+{
+    uint8_t count = 0;
+    while (count < INTERVAL_MAX_COUNT && current.intervals[count] != 0)
+    {
+        count++;
+    }
+    return count;
+}
+
+uint8_t Tunables::read(uint8_t id, uint8_t *value, uint8_t &length) const
+{
+    if (id == 0 || id >= NUM_TUNABLES)
+    {
+        return TUNABLES_BAD_ID;
+    }
+
+    length = fields[id].size;
+    memcpy(value, (const uint8_t *)&current + fields[id].offset, length);
+    return TUNABLES_OK;
+}
+
+uint8_t Tunables::write(uint8_t id, const uint8_t *value, uint8_t length)
+{
+    if (id == 0 || id >= NUM_TUNABLES)
+    {
+        return TUNABLES_BAD_ID;
+    }
+    if (length > fields[id].size)
+    {
+        return TUNABLES_BAD_LENGTH;
+    }
+
+    TunablesRecord next = current;
+    uint8_t *field = (uint8_t *)&next + fields[id].offset;
+    memset(field, 0, fields[id].size);
+    memcpy(field, value, length);
+    return apply(next);
+}
+
+uint8_t Tunables::import(const uint8_t *blob, uint8_t length)
+{
+    if (length != sizeof(TunablesRecord))
+    {
+        return TUNABLES_BAD_LENGTH;
+    }
+
+    TunablesRecord next;
+    memcpy(&next, blob, sizeof(next));
+    if (next.version != TUNABLES_VERSION || next.crc != recordCrc(next))
+    {
+        return TUNABLES_BAD_VERSION;
+    }
+    return apply(next);
+}
+
+uint8_t Tunables::reset()
+{
+    TunablesRecord next;
+    defaults(next);
+    return apply(next);
+}
+
+uint8_t Tunables::apply(TunablesRecord &next)
+{
+    if (!valid(next))
+    {
+        return TUNABLES_BAD_VALUE;
+    }
+
+    next.crc = recordCrc(next);
+    if (memcmp(&next, &current, sizeof(next)) != 0)
+    {
+        if (preferences.putBytes(TUNABLES_KEY, &next, sizeof(next)) != sizeof(next))
+        {
+            return TUNABLES_WRITE_FAILED;
+        }
+        current = next;
+        commits++;
+    }
+
+    bool identity = memcmp(current.mac, booted.mac, sizeof(current.mac)) != 0 ||
+        strcmp(current.name, booted.name) != 0;
+    return identity ? TUNABLES_OK_RESTART : TUNABLES_OK;
+}
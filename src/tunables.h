@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <Preferences.h>
+#include "config.h"
+#include "jiggle.h"
+
+// What used to take a rebuild to change, set over serial (see protocol.h)
+// and stored as one NVS blob. Exported and imported as a whole in this
+// exact layout, little endian, tools/config.py knows it too. The CRC covers
+// the fields before it.
+struct TunablesRecord {
+    uint8_t version;
+    uint8_t reserved;
+    JiggleParams jiggle;
+    uint32_t timeVariance;                    // Milliseconds, +/- around the interval
+    uint16_t intervals[INTERVAL_MAX_COUNT];   // Seconds, the ones in use first, 0 after them
+    uint8_t mac[6];                           // Base address, byte 4 gets 0x10 added with MOUSE_HIRES
+    char name[BLE_NAME_MAX + 1];              // Zero terminated
+    uint32_t crc;
+};
+
+#define TUNABLES_VERSION 1
+
+static_assert(sizeof(TunablesRecord) == 72, "the layout is shared with tools/config.py");
+
+// One field per ID, values are the field's bytes. A shorter value is zero
+// padded, so small numbers and short names need not be sent in full.
+enum TunableId : uint8_t {
+    TUNABLE_MIN_DISTANCE = 1,
+    TUNABLE_MAX_DISTANCE,
+    TUNABLE_CURVE,
+    TUNABLE_JITTER,
+    TUNABLE_WHEEL_CHANCE,
+    TUNABLE_WHEEL_MIN,
+    TUNABLE_WHEEL_MAX,
+    TUNABLE_STEP_INTERVAL,
+    TUNABLE_WHEEL_STEP_INTERVAL,
+    TUNABLE_WHEEL_PEAK_PAUSE,
+    TUNABLE_TIME_VARIANCE,
+    TUNABLE_INTERVALS,
+    TUNABLE_MAC,
+    TUNABLE_NAME,
+    NUM_TUNABLES
+};
+
+// Results, also the status byte of a protocol reply
+#define TUNABLES_OK 0x00
+#define TUNABLES_OK_RESTART 0x01     // Stored, takes effect after a restart
+#define TUNABLES_BAD_ID 0x82
+#define TUNABLES_BAD_LENGTH 0x83
+#define TUNABLES_BAD_VALUE 0x84      // Out of range, or does not fit the other fields
+#define TUNABLES_BAD_VERSION 0x85    // Or a CRC that does not match, for an imported blob
+#define TUNABLES_WRITE_FAILED 0x86
+
+// Defaults come from config.h. Every change is checked as a whole record,
+// written to flash right away and only then used.
+class Tunables
+{
+public:
+    Tunables(Preferences &preferences) : preferences(preferences) {}
+
+    void begin();
+    const TunablesRecord &get() const { return current; }
+    uint8_t intervalCount() const;
+
+    uint8_t read(uint8_t id, uint8_t *value, uint8_t &length) const;
+    uint8_t write(uint8_t id, const uint8_t *value, uint8_t length);
+    uint8_t import(const uint8_t *blob, uint8_t length);
+    uint8_t reset();  // Back to the defaults
+
+    static void defaults(TunablesRecord &record);
+    static bool valid(const TunablesRecord &record);
+
+    uint32_t commits = 0;
+
+private:
+    Preferences &preferences;
+    TunablesRecord current = {};
+    TunablesRecord booted = {};  // Name and MAC only change with a restart
+
+    uint8_t apply(TunablesRecord &next);
+};
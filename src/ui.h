@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include "config.h"
+
+// The engine (loop(): BLE, jiggles, settings) and the UI (display and
+// buttons) run on different cores. The engine publishes a UiState snapshot
+// through a seqlock, the UI sends commands back through an SPSC queue.
+
+// What the display shows
+struct UiState {
+    uint32_t jiggleCount;
+    uint32_t nextJiggleAt;   // millis()
+    int32_t jiggleInterval;  // Milliseconds
+    int16_t intervalSeconds;
+    uint8_t hosts;           // Bit per connected host slot
+    uint8_t flags;
+    int8_t rssi;             // Filtered, of the weakest host, 0 before a reading
+    int8_t txPower;          // dBm, on that host's link
+};
+
+#define UI_CONNECTED 1
+#define UI_RUNNING 2
+#define UI_OFF_HOURS 4  // Outside the active windows
+
+// What the buttons ask for
+enum UiCommand : uint8_t {
+    COMMAND_TOGGLE_RUNNING,
+    COMMAND_NEXT_INTERVAL,
+    COMMAND_DISCONNECT_HOSTS
+};
+
+#define COMMAND_QUEUE_SIZE 8  // Power of two
+
+// What the build profile compiles in. Code that only exists with a display
+// is behind #if UI_DISPLAY, the rest branches on these with if constexpr.
+struct UiPolicy {
+    static constexpr bool display = UI_DISPLAY;
+    static constexpr bool animations = UI_PROFILE == UI_FULL;  // Spinner and boot animation
+    static constexpr bool progressBar = UI_PROFILE == UI_FULL;
+    static constexpr bool serialStatus = !UI_DISPLAY;          // Status lines on serial instead
+    static constexpr const char *name = UI_PROFILE == UI_FULL ? "full" : UI_PROFILE == UI_MINIMAL ? "minimal" : "headless";
+};
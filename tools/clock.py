@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Set the jiggler's clock from this computer, for the active windows.
+
+Sends the UTC time and this computer's UTC offset over serial. The RTC keeps
+the time through deep sleep and restarts but drifts a little, run this again
+now and then, and after every change to daylight saving time:
+
+    python3 tools/clock.py /dev/ttyUSB0    # needs pyserial
+"""
+
+import argparse
+import sys
+import time
+
+COMMAND = "C"  # SCHEDULE_CLOCK_COMMAND in src/config.h
+REPLY_WAIT = 2  # Seconds to wait for the confirmation line
+
+
+def offset_minutes(now):
+    local = time.localtime(now)
+    return local.tm_gmtoff // 60
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port")
+    parser.add_argument("--offset", type=int, help="UTC offset in minutes instead of this computer's")
+    args = parser.parse_args()
+
+    import serial  # pyserial
+
+    port = serial.Serial(args.port, 115200, timeout=REPLY_WAIT)
+    now = int(time.time())
+    offset = args.offset if args.offset is not None else offset_minutes(now)
+    port.write(("%s%d %d\n" % (COMMAND, now, offset)).encode())
+
+    # The log goes on around the reply
+    deadline = time.time() + REPLY_WAIT
+    while time.time() < deadline:
+        line = port.readline().decode(errors="replace").strip()
+        if line.startswith("clock:"):
+            print(line)
+            return 0
+    print("no reply, is the firmware running?")
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""Read and change the jiggler's tunables over serial, without reflashing.
+
+Every command is one binary frame, see src/protocol.h. Changes are checked
+and stored in flash by the firmware, the new name and MAC address need a
+restart:
+
+    python3 tools/config.py /dev/ttyUSB0 get                   # needs pyserial
+    python3 tools/config.py /dev/ttyUSB0 set max_distance 20 intervals 30,60,120
+    python3 tools/config.py /dev/ttyUSB0 set name "Desk Mouse" mac 00:1F:20:37:10:CB
+    python3 tools/config.py /dev/ttyUSB0 restart
+    python3 tools/config.py /dev/ttyUSB0 export fleet.bin     # the whole record, for import on others
+    python3 tools/config.py /dev/ttyUSB0 import fleet.bin
+
+--offline writes the request frames to a file instead, for the simulator,
+and --decode prints the replies found in a capture:
+
+    python3 tools/config.py --offline requests.bin set jitter 10
+    .pio/build/native/program --days 0.01 --input requests.bin --capture capture.bin
+    python3 tools/config.py --decode capture.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"\xa5\x43"
+HEADER = struct.Struct("<BBB")  # op, seq, length
+PAYLOAD_MAX = 80  # CONFIG_PAYLOAD_MAX in src/protocol.h
+REPLY_WAIT = 1  # Seconds to wait for a reply
+RETRIES = 3  # On no reply or a frame the firmware could not read
+
+GET, SET, EXPORT, IMPORT, DEFAULTS, RESTART = range(1, 7)
+REPLY = 0x80
+OPS = {GET: "get", SET: "set", EXPORT: "export", IMPORT: "import", DEFAULTS: "defaults", RESTART: "restart"}
+
+STATUS = {
+    0x00: "ok",
+    0x01: "ok, restart to apply",
+    0x80: "bad CRC",
+    0x81: "bad command",
+    0x82: "unknown setting",
+    0x83: "bad length",
+    0x84: "out of range",
+    0x85: "not a record of this version",
+    0x86: "flash write failed",
+}
+BAD_CRC = 0x80
+
+# Name, ID and layout of every tunable, as in src/tunables.h
+FIELDS = [
+    ("min_distance", 1, "B"),
+    ("max_distance", 2, "B"),
+    ("curve", 3, "B"),
+    ("jitter", 4, "B"),
+    ("wheel_chance", 5, "B"),
+    ("wheel_min", 6, "B"),
+    ("wheel_max", 7, "B"),
+    ("step_interval", 8, "H"),
+    ("wheel_step_interval", 9, "H"),
+    ("wheel_peak_pause", 10, "H"),
+    ("time_variance", 11, "I"),
+    ("intervals", 12, "8H"),
+    ("mac", 13, "6s"),
+    ("name", 14, "26s"),
+]
+BY_NAME = {name: (id, fmt) for name, id, fmt in FIELDS}
+BY_ID = {id: (name, fmt) for name, id, fmt in FIELDS}
+
+# TunablesRecord: version, reserved, the jiggle parameters with a reserved
+# byte after wheel_max, time variance, intervals, MAC, name, CRC
+RECORD = struct.Struct("<BB7BBHHHI8H6s26sI")
+RECORD_VERSION = 1
+
+
+def frame(op, seq, payload=b""):
+    body = HEADER.pack(op, seq, len(payload)) + payload
+    return MAGIC + body + struct.pack("<I", zlib.crc32(body))
+
+
+def frames(data):
+    """Yield (op, seq, payload) for every valid frame, skipping the text log."""
+    start = 0
+    while True:
+        start = data.find(MAGIC, start)
+        if start < 0 or start + 2 + HEADER.size > len(data):
+            return
+        op, seq, length = HEADER.unpack_from(data, start + 2)
+        end = start + 2 + HEADER.size + length
+        if length > PAYLOAD_MAX or end + 4 > len(data):
+            start += 1
+            continue
+        (crc,) = struct.unpack_from("<I", data, end)
+        if crc != zlib.crc32(data[start + 2:end]):
+            start += 1
+            continue
+        yield op, seq, data[start + 2 + HEADER.size:end]
+        start = end + 4
+
+
+def encode(name, text):
+    if name not in BY_NAME:
+        raise ValueError("unknown setting %s, one of %s" % (name, ", ".join(BY_NAME)))
+    id, fmt = BY_NAME[name]
+    if name == "intervals":
+        values = [int(v) for v in text.split(",")]
+        value = struct.pack("<%dH" % len(values), *values)
+    elif name == "mac":
+        value = bytes(int(v, 16) for v in text.split(":"))
+    elif name == "name":
+        value = text.encode("ascii")
+    else:
+        value = struct.pack("<" + fmt, int(text, 0))
+    # Shorter values are zero padded by the firmware
+    if len(value) > struct.calcsize("<" + fmt):
+        raise ValueError("%s is too long for %s" % (text, name))
+    return bytes([id]) + value
+
+
+def format_value(name, value):
+    fmt = BY_NAME[name][1]
+    value = value.ljust(struct.calcsize("<" + fmt), b"\0")
+    if name == "intervals":
+        return ",".join(str(v) for v in struct.unpack("<8H", value) if v)
+    if name == "mac":
+        return ":".join("%02X" % b for b in value)
+    if name == "name":
+        return value.split(b"\0")[0].decode("ascii", errors="replace")
+    return str(struct.unpack("<" + fmt, value)[0])
+
+
+def format_record(blob):
+    fields = RECORD.unpack(blob)
+    if fields[0] != RECORD_VERSION:
+        return ["record version %d, this tool knows %d" % (fields[0], RECORD_VERSION)]
+    values = list(fields[2:9]) + list(fields[10:14])
+    lines = ["%-20s %s" % (name, v) for (name, _, _), v in zip(FIELDS, values)]
+    lines.append("%-20s %s" % ("intervals", format_value("intervals", blob[20:36])))
+    lines.append("%-20s %s" % ("mac", format_value("mac", blob[36:42])))
+    lines.append("%-20s %s" % ("name", format_value("name", blob[42:68])))
+    return lines
+
+
+def describe(op, payload):
+    """One line for a reply, the record for an export."""
+    request = op & ~REPLY
+    status = payload[0] if payload else BAD_CRC
+    text = "%s: %s" % (OPS.get(request, "op %d" % request), STATUS.get(status, "status 0x%02x" % status))
+    if status != 0:
+        return [text]
+    if request == GET and len(payload) >= 2 and payload[1] in BY_ID:
+        name = BY_ID[payload[1]][0]
+        return ["%-20s %s" % (name, format_value(name, payload[2:]))]
+    if request == EXPORT and len(payload) == 1 + RECORD.size:
+        return format_record(payload[1:])
+    return [text]
+
+
+def requests(args):
+    """(op, payload) for the command line."""
+    if args.command == "get":
+        names = args.args or [name for name, _, _ in FIELDS]
+        for name in names:
+            if name not in BY_NAME:
+                raise ValueError("unknown setting %s" % name)
+        return [(GET, bytes([BY_NAME[name][0]])) for name in names]
+    if args.command == "set":
+        if not args.args or len(args.args) % 2:
+            raise ValueError("set takes pairs of name and value")
+        return [(SET, encode(name, value)) for name, value in zip(args.args[::2], args.args[1::2])]
+    if args.command == "import":
+        if len(args.args) != 1:
+            raise ValueError("import takes a file")
+        with open(args.args[0], "rb") as f:
+            blob = f.read()
+        if len(blob) != RECORD.size:
+            raise ValueError("%s is not an exported record" % args.args[0])
+        return [(IMPORT, blob)]
+    if args.command == "export":
+        if len(args.args) > 1:
+            raise ValueError("export takes a file, or none to only print the record")
+        return [(EXPORT, b"")]
+    return [({"defaults": DEFAULTS, "restart": RESTART}[args.command], b"")]
+
+
+def transact(port, op, seq, payload):
+    """Sends a frame and waits for its reply, again on no reply or a bad CRC."""
+    for _ in range(RETRIES):
+        port.write(frame(op, seq, payload))
+        data = b""
+        deadline = time.time() + REPLY_WAIT
+        while time.time() < deadline:
+            data += port.read(port.in_waiting or 1)
+            for reply_op, reply_seq, reply in frames(data):
+                if reply_op == op | REPLY and reply_seq == seq:
+                    if reply and reply[0] == BAD_CRC:
+                        break
+                    return reply
+            else:
+                continue
+            break
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("target", nargs="?", help="serial port, or the request file with --offline")
+    parser.add_argument("command", nargs="?", choices=["get", "set", "export", "import", "defaults", "restart"])
+    parser.add_argument("args", nargs="*", help="names, name value pairs or a file")
+    parser.add_argument("--offline", action="store_true", help="write the request frames to target")
+    parser.add_argument("--decode", metavar="CAPTURE", help="print the replies in a capture and exit")
+    args = parser.parse_args()
+
+    if args.decode:
+        with open(args.decode, "rb") as f:
+            data = f.read()
+        for op, seq, payload in frames(data):
+            if op & REPLY:
+                print("\n".join(describe(op, payload)))
+        return 0
+
+    if not args.target or not args.command:
+        parser.error("target and command are needed")
+    try:
+        pending = requests(args)
+    except (ValueError, OSError) as e:
+        print(e)
+        return 2
+
+    seq = int(time.time()) & 0xFF
+    if args.offline:
+        with open(args.target, "wb") as f:
+            for i, (op, payload) in enumerate(pending):
+                f.write(frame(op, (seq + i) & 0xFF, payload))
+        return 0
+
+    import serial  # pyserial
+
+    port = serial.Serial(args.target, 115200, timeout=0.1)
+    failed = False
+    for i, (op, payload) in enumerate(pending):
+        reply = transact(port, op, (seq + i) & 0xFF, payload)
+        if reply is None:
+            print("no reply, is the firmware running?")
+            return 1
+        print("\n".join(describe(op | REPLY, reply)))
+        failed |= reply[0] > 1
+        if op == EXPORT and reply[0] == 0 and args.args:
+            with open(args.args[0], "wb") as f:
+                f.write(reply[1:])
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
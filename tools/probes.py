@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Decode the latency probe frames a PROBES=1 build writes to serial.
+
+Reads a capture of the serial output (a file, a serial port, or stdin),
+skips the text log around the frames and prints p50/p99/max per probe from
+the newest frame, plus every slow record seen.
+
+    python3 tools/probes.py /dev/ttyUSB0        # needs pyserial
+    python3 tools/probes.py capture.bin
+    .pio/build/native/program --days 1 --verbose | python3 tools/probes.py
+"""
+
+import struct
+import sys
+import zlib
+
+MAGIC = b"\xa5\x5a"
+HEADER = struct.Struct("<BBBBHII")  # version, probes, buckets, slow events, reserved, time, slow total
+SLOW = struct.Struct("<IIB3x")
+VERSION = 1
+STATS_WAIT = 65  # One STATS_INTERVAL plus some slack, seconds
+NAMES = ["loop", "render", "jiggle", "notify"]  # Same order as ProbeId in src/probe.h
+
+
+def name(probe):
+    return NAMES[probe] if probe < len(NAMES) else "probe %d" % probe
+
+
+def percentile(buckets, count, fraction):
+    """Log2 bucket the percentile falls in, as a bound in microseconds."""
+    if count == 0:
+        return "-"
+    target = count * fraction
+    seen = 0
+    for bucket, n in enumerate(buckets):
+        seen += n
+        if n and seen >= target:
+            break
+    # Bucket 0 is under 1 us, bucket n from 2^(n-1) us, the last one open ended
+    if bucket == len(buckets) - 1:
+        return ">=%d" % (1 << (bucket - 1))
+    return "<%d" % (1 << bucket)
+
+
+def frames(data):
+    """Yield (time, slow total, histograms, slow records) for every valid frame."""
+    start = 0
+    while True:
+        start = data.find(MAGIC, start)
+        if start < 0 or start + 2 + HEADER.size > len(data):
+            return
+        version, probes, buckets, slow, _, time, slow_total = HEADER.unpack_from(data, start + 2)
+        histogram = struct.Struct("<II%dI" % buckets)
+        end = start + 2 + HEADER.size + probes * histogram.size + slow * SLOW.size
+        if version != VERSION or end + 4 > len(data):
+            start += 1
+            continue
+        (crc,) = struct.unpack_from("<I", data, end)
+        if crc != zlib.crc32(data[start + 2:end]):
+            start += 1
+            continue
+
+        offset = start + 2 + HEADER.size
+        histograms = []
+        for _ in range(probes):
+            fields = histogram.unpack_from(data, offset)
+            histograms.append((fields[0], fields[1], fields[2:]))
+            offset += histogram.size
+        records = []
+        for _ in range(slow):
+            records.append(SLOW.unpack_from(data, offset))
+            offset += SLOW.size
+
+        yield time, slow_total, histograms, records
+        start = end + 4
+
+
+def read(path):
+    if path == "-":
+        return sys.stdin.buffer.read()
+    if path.startswith("/dev/"):
+        import serial  # pyserial, only needed for a live port
+
+        port = serial.Serial(path, 115200, timeout=STATS_WAIT)
+        data = b""
+        try:
+            while True:
+                chunk = port.read(4096)
+                data += chunk
+                if not chunk and MAGIC in data:
+                    break
+        except KeyboardInterrupt:
+            pass
+        return data
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "-"
+    last = None
+    slow = []
+    for frame in frames(read(path)):
+        last = frame
+        slow.extend(frame[3])
+
+    if last is None:
+        print("no probe frames found, is the firmware built with -DPROBES=1?")
+        return 1
+
+    time, slow_total, histograms, _ = last
+    print("probes at %.1f s since boot" % (time / 1000))
+    print("%-8s %10s %10s %10s %10s" % ("probe", "count", "p50 us", "p99 us", "max us"))
+    for probe, (count, max_us, buckets) in enumerate(histograms):
+        print("%-8s %10d %10s %10s %10d" % (name(probe), count,
+              percentile(buckets, count, 0.50), percentile(buckets, count, 0.99), max_us))
+
+    print("slow: %d since boot, %d received" % (slow_total, len(slow)))
+    for record_time, us, probe in slow:
+        print("  %10.3f s %-8s %d us" % (record_time / 1000, name(probe), us))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Builds every firmware profile and prints its flash and RAM use, as
+# reported by PlatformIO at the end of the build.
+set -e
+cd "$(dirname "$0")/.."
+mkdir -p .pio
+
+used() {
+    # "RAM:   [=         ]   9.5% (used 31200 bytes from 327680 bytes)"
+    grep "^$1:" "$2" | sed 's/.*(used \([0-9]*\) bytes.*/\1/'
+}
+
+printf '%-28s %10s %10s\n' profile flash ram
+for env in hiletgo-esp32-lcd hiletgo-esp32-lcd-minimal hiletgo-esp32-headless
+do
+    log=".pio/size-$env.log"
+    if ! pio run -e "$env" > "$log" 2>&1
+    then
+        cat "$log"
+        exit 1
+    fi
+    printf '%-28s %10s %10s\n' "$env" "$(used Flash "$log")" "$(used RAM "$log")"
+done
@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+"""Decode the HID trace the firmware writes to serial and check it.
+
+Sends the dump command to a serial port, or reads a capture (a file or
+stdin) that has the trace frame somewhere in the text log. Prints the
+jiggle gaps against the interval +/- JIGGLE_TIME_VARIANCE, the net
+displacement of every jiggle and the report rate. --export writes the
+records as text for the simulator to check the same way it checks its own
+runs:
+
+    python3 tools/trace.py /dev/ttyUSB0 --export trace.txt    # needs pyserial
+    .pio/build/native/program --replay trace.txt
+
+    .pio/build/native/program --days 1 --capture capture.bin
+    python3 tools/trace.py capture.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b"\xa5\x54"
+# version, reserved, time, base time, records, overwritten, lost, variance, length,
+# base interval, base hosts, base running, reserved
+HEADER = struct.Struct("<BBIIIIIIHHBBH")
+VERSIONS = (1, 2)  # 2 added WIDE
+COMMAND = b"T"  # TRACE_DUMP_COMMAND in src/config.h
+DUMP_WAIT = 2  # Seconds of quiet after the frame, the text log goes on around it
+BURST_GAP = 5000  # Reports closer together than this belong to the same jiggle, as in sim/simulator.cpp
+
+# Record flags, see src/trace.h
+FIELDS = ["buttons", "x", "y", "wheel", "hwheel"]
+WIDE = 0x20  # Fields are 16 bits
+ABSOLUTE = 0x40
+STATE = 0x80
+
+
+def frames(data):
+    """Yield (header fields, record bytes) for every valid frame."""
+    start = 0
+    while True:
+        start = data.find(MAGIC, start)
+        if start < 0 or start + 2 + HEADER.size > len(data):
+            return
+        header = HEADER.unpack_from(data, start + 2)
+        length = header[8]
+        end = start + 2 + HEADER.size + length
+        if header[0] not in VERSIONS or end + 4 > len(data):
+            start += 1
+            continue
+        (crc,) = struct.unpack_from("<I", data, end)
+        if crc != zlib.crc32(data[start + 2:end]):
+            start += 1
+            continue
+
+        yield header, data[start + 2 + HEADER.size:end]
+        start = end + 4
+
+
+def records(header, data):
+    """Yield (time, kind, values): "report" with the five fields, "state"
+    with hosts, running and interval seconds, "boot" before the first record
+    of every boot. Starts with "truncated" when older records were
+    overwritten, the first jiggle may then be missing its beginning, and the
+    state at that point if the frame has it."""
+    time = header[3]
+    overwritten = header[5]
+    base_interval, base_hosts, base_running = header[9:12]
+    if overwritten:
+        yield time, "truncated", ()
+    if base_interval:
+        yield time, "state", (base_hosts, base_running, base_interval)
+    offset = 0
+    while offset < len(data):
+        flags = data[offset]
+        offset += 1
+        value = 0
+        shift = 0
+        while True:
+            byte = data[offset]
+            offset += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+
+        if flags & ABSOLUTE:
+            time = value
+            yield time, "boot", ()
+        else:
+            time = (time + value) & 0xFFFFFFFF
+
+        if flags & STATE:
+            hosts, running, interval = struct.unpack_from("<BBH", data, offset)
+            offset += 4
+            yield time, "state", (hosts, running, interval)
+        else:
+            fields = []
+            for bit in range(len(FIELDS)):
+                if flags & (1 << bit):
+                    size = 2 if flags & WIDE else 1
+                    fields.append(struct.unpack_from("<h" if size == 2 else "<b", data, offset)[0])
+                    offset += size
+                else:
+                    fields.append(0)
+            yield time, "report", tuple(fields)
+
+
+class Jiggle:
+    def __init__(self, time, segment, interval):
+        self.time = time
+        self.segment = segment  # Stretch without state changes or restarts
+        self.interval = interval  # Seconds, None before the first state record
+        self.net = [0, 0, 0]  # x, y, wheel
+        self.reports = 0
+        self.partial = False  # Beginning overwritten
+        self.complete = False  # Ended by a gap, not cut short by a state change or restart
+
+
+def jiggles(trace):
+    """Group the reports into jiggles."""
+    segment = 0
+    interval = None
+    jiggle = None
+    last = None
+    truncated = False
+    for time, kind, values in trace:
+        if kind == "truncated":
+            truncated = True
+            continue
+        if kind != "report":
+            # Whatever was left of a jiggle never went out
+            segment += 1
+            if kind == "state":
+                interval = values[2]
+            if jiggle:
+                yield jiggle
+            jiggle = None
+            continue
+
+        if jiggle and time - last > BURST_GAP:
+            jiggle.complete = not jiggle.partial
+            yield jiggle
+            jiggle = None
+        if not jiggle:
+            jiggle = Jiggle(time, segment, interval)
+            jiggle.partial = truncated
+            truncated = False
+        for i in range(3):
+            jiggle.net[i] += values[1 + i]
+        jiggle.reports += 1
+        last = time
+    if jiggle:
+        yield jiggle
+
+
+def analyze(header, trace, out):
+    now, _, count, overwritten, lost, variance, length = header[2:9]
+    reports = [r for r in trace if r[1] == "report"]
+    print("trace at %.1f s since boot: %d records in %d bytes, %d overwritten, %d lost"
+          % (now / 1000, count, length, overwritten, lost), file=out)
+    if not reports:
+        print("no reports", file=out)
+        return True
+
+    span = max((reports[-1][0] - reports[0][0]) / 1000, 1)
+    print("reports: %d, %.1f per minute, %.2f bytes per record" % (len(reports), len(reports) / span * 60,
+          length / max(count, 1)), file=out)
+
+    # Gaps between jiggles within one stretch, the first one after a state
+    # change waited for a different interval
+    found = list(jiggles(trace))
+    deviations = []
+    for previous, current in zip(found, found[1:]):
+        if current.segment == previous.segment and current.interval and not previous.partial:
+            deviations.append(current.time - previous.time - current.interval * 1000)
+    bad = sum(abs(d) > variance for d in deviations)
+
+    if deviations:
+        print("jiggle gap minus interval, %d gaps, %d outside +/- %.1f s:" % (len(deviations), bad, variance / 1000),
+              file=out)
+        step = max(variance // 4, 1)
+        buckets = {}
+        for deviation in deviations:
+            buckets[deviation // step] = buckets.get(deviation // step, 0) + 1
+        for bucket in range(min(buckets), max(buckets) + 1):
+            n = buckets.get(bucket, 0)
+            print("  %+6.1f s to %+6.1f s %6d %s" % (bucket * step / 1000, (bucket + 1) * step / 1000, n,
+                  "#" * min(n, 50)), file=out)
+
+    complete = [j for j in found if j.complete]
+    open_paths = [j for j in complete if any(j.net)]
+    print("jiggles: %d, %d complete, %d of those did not return to start" % (len(found), len(complete),
+          len(open_paths)), file=out)
+    for j in open_paths:
+        print("  %10.3f s net x %+d, y %+d, wheel %+d" % (j.time / 1000, j.net[0], j.net[1], j.net[2]), file=out)
+    if complete:
+        reports_per = sum(j.reports for j in complete) / len(complete)
+        print("reports per jiggle: %.1f" % reports_per, file=out)
+
+    return bad == 0 and not open_paths
+
+
+def export(path, variance, trace):
+    with open(path, "w") as f:
+        f.write("# HID trace, exported by tools/trace.py\n# variance %d\n" % variance)
+        for time, kind, values in trace:
+            f.write(" ".join(str(v) for v in (time, kind) + tuple(values)) + "\n")
+
+
+def read(path):
+    if path == "-":
+        return sys.stdin.buffer.read()
+    if path.startswith("/dev/"):
+        import serial  # pyserial, only needed for a live port
+
+        port = serial.Serial(path, 115200, timeout=DUMP_WAIT)
+        port.write(COMMAND)
+        data = b""
+        while True:
+            chunk = port.read(4096)
+            data += chunk
+            if not chunk:
+                break
+        return data
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", nargs="?", default="-", help="serial port, capture file or - for stdin")
+    parser.add_argument("--export", metavar="FILE", help="write the records as text for the simulator's --replay")
+    args = parser.parse_args()
+
+    last = None
+    for frame in frames(read(args.source)):
+        last = frame
+    if last is None:
+        print("no trace frame found")
+        return 2
+
+    header, data = last
+    trace = list(records(header, data))
+    if args.export:
+        export(args.export, header[7], trace)
+    return 0 if analyze(header, trace, sys.stdout) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())